@@ -0,0 +1,87 @@
+//
+// Created by Niccolo on 28/06/2025.
+//
+
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Scatola allineata agli assi. La sfera che la contiene ha lo stesso centro e raggio pari alla
+// semidiagonale: basta una sola struttura per alberi, terreno e muri
+struct Bounds {
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    [[nodiscard]] bool empty() const {
+        return min.x > max.x;
+    }
+    void expand(const glm::vec3 &p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    // Sfera di raggio r attorno a p
+    void expand(const glm::vec3 &p, float r) {
+        min = glm::min(min, p - r);
+        max = glm::max(max, p + r);
+    }
+    void expand(const Bounds &other) {
+        if (!other.empty()) {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+    }
+
+    [[nodiscard]] glm::vec3 center() const {
+        return empty() ? glm::vec3(0.0f) : 0.5f * (min + max);
+    }
+    [[nodiscard]] float radius() const {
+        return empty() ? 0.0f : 0.5f * glm::length(max - min);
+    }
+
+    [[nodiscard]] Bounds inflated(float margin) const;
+    // Scatola che contiene questa dopo scala, rotazione e traslazione (come le istanze dell'arena)
+    [[nodiscard]] Bounds transformed(const glm::vec3 &position, const glm::quat &orientation, const glm::vec3 &scale) const;
+};
+
+// Sfere in forma di struttura di array, per testarne quattro alla volta contro il frustum
+struct SphereSet {
+    std::vector<float> x, y, z, r;
+
+    void clear();
+    void push(const glm::vec3 &center, float radius);
+    [[nodiscard]] size_t size() const {
+        return r.size();
+    }
+};
+
+enum class Containment : uint8_t {
+    Outside,
+    Intersects,
+    Inside
+};
+
+// Sei piani (sinistra, destra, basso, alto, vicino, lontano) con la normale verso l'interno:
+// p è dentro il piano se dot(xyz, p) + w >= 0
+struct Frustum {
+    std::array<glm::vec4, 6> planes{};
+
+    // Piani estratti dalle righe di projection * view (Gribb-Hartmann), normalizzati
+    static Frustum from(const glm::mat4 &view_projection);
+
+    [[nodiscard]] bool intersects(const glm::vec3 &center, float radius) const;
+    [[nodiscard]] bool intersects(const Bounds &box) const;
+    // Inside se la scatola è tutta dentro il frustum: i suoi contenuti non vanno più testati
+    [[nodiscard]] Containment classify(const Bounds &box) const;
+    // visible[i] = 1 se la sfera i interseca il frustum. Il test è conservativo: una sfera vicina
+    // a uno spigolo può risultare visibile anche se è fuori
+    void cull(const SphereSet &spheres, std::vector<uint8_t> &visible) const;
+};
+
+#endif //BOUNDS_H
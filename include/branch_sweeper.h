@@ -0,0 +1,55 @@
+//
+// Created by Niccolo on 27/06/2025.
+//
+
+#ifndef BRANCH_SWEEPER_H
+#define BRANCH_SWEEPER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "interpreter.h"
+#include "mesh.h"
+
+// Alternativa ai cilindri per segmento: ricostruisce dai moduli F le catene di rami (la fine di un
+// ramo è l'inizio del successivo) e per ogni catena genera un solo tubo continuo. Gli anelli sono
+// condivisi tra segmenti consecutivi, quindi non servono né le basi né le giunzioni.
+// Il numero di lati di ogni catena dipende dal suo raggio: i rami sottili ne hanno meno
+class BranchSweeper {
+public:
+    // Stessi parametri della mesh del ramo: lunghezza, raggio e risoluzione a scala 1
+    BranchSweeper(float length, float radius, unsigned int resolution);
+
+    // Aggiunge in coda a vertices/indices i tubi di tutti i rami, in coordinate dell'albero
+    void sweep(const std::vector<ModuleInstance> &branches, std::vector<Vertex> &vertices,
+               std::vector<unsigned int> &indices) const;
+
+    // Lati dell'anello per un raggio: stesso errore di corda del tronco alla risoluzione piena
+    [[nodiscard]] unsigned int ring_resolution(float r) const;
+    // Limite superiore dei byte generati, nel caso in cui nessun ramo si colleghi al successivo
+    [[nodiscard]] size_t estimate(size_t branches) const;
+
+    [[nodiscard]] float length() const {
+        return branch_length;
+    }
+    [[nodiscard]] float radius() const {
+        return branch_radius;
+    }
+    [[nodiscard]] unsigned int resolution() const {
+        return max_resolution;
+    }
+private:
+    static constexpr unsigned int MIN_RESOLUTION = 3;
+    // Distanza massima, relativa alla lunghezza, tra la fine di un ramo e l'inizio del successivo
+    static constexpr float LINK_TOLERANCE = 1e-3f;
+
+    void sweep_chain(const std::vector<ModuleInstance> &branches, const std::vector<uint32_t> &chain,
+                     const std::vector<glm::vec3> &directions, const std::vector<glm::vec3> &ends,
+                     std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) const;
+
+    float branch_length;
+    float branch_radius;
+    unsigned int max_resolution;
+};
+
+#endif //BRANCH_SWEEPER_H
@@ -8,6 +8,8 @@
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
+#include "bounds.h"
+
 enum Camera_Movement {
     FORWARD,
     BACKWARD,
@@ -56,6 +58,11 @@ public:
         return glm::lookAt(position, position + front, up);
     }
 
+    // Piani del frustum in coordinate mondo per la proiezione data
+    [[nodiscard]] Frustum GetFrustum(const glm::mat4 &projection) const {
+        return Frustum::from(projection * GetViewMatrix());
+    }
+
     void ProcessKeyboard(Camera_Movement direction, float deltaTime);
 
     void ProcessMouseMovement(float xoffset, float yoffset);
@@ -0,0 +1,51 @@
+//
+// Created by Niccolo on 30/06/2025.
+//
+
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Stesso layout std140 del blocco FrameData in shaders/frame_data.glsl
+struct FrameData {
+    glm::mat4 view{1.0f};
+    glm::mat4 projection{1.0f};
+    glm::mat4 viewProj{1.0f};
+    glm::mat4 skyViewProj{1.0f};
+    glm::vec4 viewPos{0.0f};
+    glm::vec4 lightDirection{0.0f, -1.0f, 0.0f, 0.0f};
+    glm::vec4 lightAmbient{0.0f};
+    glm::vec4 lightDiffuse{0.0f};
+    glm::vec4 lightSpecular{0.0f};
+    glm::vec4 time{0.0f};
+
+    // Riempie view, projection e le matrici derivate
+    void setCamera(const glm::mat4 &view_matrix, const glm::mat4 &projection_matrix, const glm::vec3 &eye);
+};
+static_assert(sizeof(FrameData) == 4 * sizeof(glm::mat4) + 6 * sizeof(glm::vec4), "FrameData deve seguire std140");
+
+// Uniform buffer di FrameData, legato una volta al binding BINDING: ogni programma che include
+// frame_data.glsl lo legge senza uniform propri per camera e luce
+class FrameUniforms {
+public:
+    FrameUniforms();
+    ~FrameUniforms();
+
+    FrameUniforms(const FrameUniforms &) = delete;
+    FrameUniforms &operator=(const FrameUniforms &) = delete;
+
+    // Un solo glBufferSubData per tutti i programmi
+    void update(const FrameData &data);
+    [[nodiscard]] const FrameData &data() const {
+        return current;
+    }
+
+    static constexpr GLuint BINDING = 0;
+private:
+    unsigned int buffer = 0;
+    FrameData current{};
+};
+
+#endif //FRAME_UNIFORMS_H
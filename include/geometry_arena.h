@@ -0,0 +1,105 @@
+//
+// Created by Niccolo on 25/06/2025.
+//
+
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "shader.h"
+
+// Intervallo di una mesh dentro l'arena
+struct ArenaRange {
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t base_vertex;
+};
+
+// Dati per istanza (attributi 3-5): posizione, quaternione in ordine xyzw e scala per asse
+struct ArenaInstance {
+    glm::vec3 position;
+    glm::vec4 orientation;
+    glm::vec3 scale;
+};
+
+// Layout fissato da OpenGL per glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Un solo VAO/VBO/EBO (più il buffer delle istanze) per tutta la geometria della scena:
+// le mesh vengono copiate una dopo l'altra e disegnate per intervallo, senza cambiare VAO
+class GeometryArena {
+public:
+    GeometryArena();
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+
+    void clear();
+    ArenaRange add(const Mesh &mesh);
+    ArenaRange add(const std::vector<Vertex> &added_vertices, const std::vector<unsigned int> &added_indices);
+    // Restituisce l'indice della prima istanza aggiunta, da usare come baseInstance
+    uint32_t add_instances(const std::vector<ArenaInstance> &instances);
+    // Carica sulla GPU tutto quello aggiunto dopo l'ultimo clear
+    void upload();
+    // Riscrive count istanze da base in poi, per quelle che cambiano durante l'esecuzione
+    void update_instances(uint32_t base, const ArenaInstance *updated, size_t count);
+
+    void bind() const;
+    // Disegno diretto di un intervallo con una sola istanza, per i passaggi fuori dal ciclo di rendering
+    void draw(const ArenaRange &range, uint32_t base_instance) const;
+    static constexpr unsigned int INSTANCE_LOCATION = 3;
+private:
+    unsigned int VAO = 0, VBO = 0, EBO = 0, instanceBuffer = 0;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<ArenaInstance> instances;
+};
+
+// Lista di comandi indiretti disegnata con una sola glMultiDrawElementsIndirect.
+// Un passaggio per materiale: tutti i comandi usano le stesse texture
+class IndirectPass {
+public:
+    IndirectPass();
+    ~IndirectPass();
+
+    IndirectPass(const IndirectPass &) = delete;
+    IndirectPass &operator=(const IndirectPass &) = delete;
+
+    void clear();
+    // Restituisce l'indice del comando, NONE se l'intervallo o le istanze sono vuoti
+    size_t add(const ArenaRange &range, uint32_t instance_count = 1, uint32_t base_instance = 0);
+    // Cambia le istanze di un comando esistente; vale dopo il prossimo upload o flush
+    void set_instances(size_t command, uint32_t instance_count, uint32_t base_instance);
+    // Alloca il buffer per tutti i comandi: solo quando i comandi cambiano di numero
+    void upload();
+    // Riscrive solo l'intervallo di comandi cambiati da set_instances, niente se non è cambiato nulla
+    void flush();
+    void draw(const GeometryArena &arena, const Material &material) const;
+
+    [[nodiscard]] size_t size() const {
+        return commands.size();
+    }
+
+    static constexpr size_t NONE = SIZE_MAX;
+private:
+    unsigned int buffer = 0;
+    std::vector<DrawElementsIndirectCommand> commands;
+    // Comandi [dirty_first, dirty_last) da riscrivere al prossimo flush
+    size_t dirty_first = SIZE_MAX, dirty_last = 0;
+};
+
+#endif //GEOMETRY_ARENA_H
@@ -0,0 +1,46 @@
+//
+// Created by Niccolo on 02/07/2025.
+//
+
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <cstdint>
+#include <glad/glad.h>
+
+// Copia lato CPU dello stato OpenGL che cambia tra un passaggio e l'altro: programma, VAO, texture
+// per unità, blend, cull e depth. Tutti i moduli passano da qui e le chiamate che non cambiano nulla
+// non arrivano al driver. C'è un solo contesto, quindi lo stato è statico
+class GLState {
+public:
+    struct Stats {
+        uint32_t issued = 0;
+        uint32_t skipped = 0;
+    };
+
+    static void useProgram(GLuint program);
+    static void bindVertexArray(GLuint vao);
+    // Come glBindTextures: textures[i] va nell'unità first + i, 0 libera l'unità
+    static void bindTextures(GLuint first, GLsizei count, const GLuint *textures);
+    // Per creare o aggiornare una texture: la collega all'unità 0 con il suo target
+    static void bindTexture(GLenum target, GLuint texture);
+
+    // GL_BLEND, GL_CULL_FACE o GL_DEPTH_TEST; le altre capacità passano senza cache
+    static void setEnabled(GLenum capability, bool enabled);
+    [[nodiscard]] static bool isEnabled(GLenum capability);
+    static void depthMask(bool write);
+    static void blendFunc(GLenum source, GLenum destination);
+
+    // Dimenticano i nomi cancellati, che OpenGL può riassegnare a oggetti nuovi
+    static void deleteProgram(GLuint program);
+    static void deleteVertexArray(GLuint vao);
+    static void deleteTextures(GLsizei count, const GLuint *textures);
+
+    // Chiude il frame: i contatori finiscono in lastFrame e ripartono da zero
+    static void endFrame();
+    [[nodiscard]] static const Stats &lastFrame();
+
+    static constexpr GLuint TEXTURE_UNITS = 16;
+};
+
+#endif //GL_STATE_H
@@ -5,50 +5,208 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
-#include <memory>
+#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <map>
-#include <stack>
 
-#include "abstract_builder.h"
-#include "branch_builder.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include "leaf_builder.h"
 
+#include "bounds.h"
+#include "token_stream.h"
+#include "worker_pool.h"
+
+// Stato compatto della turtle: la terna locale si ricava dall'orientamento, la scala da due fattori
 struct TurtleState {
-    // Per la traslazione
     glm::vec3 position;
-    // Per rotazione
     glm::quat orientation;
-    // Per trovare la direzione corretta dove far muovere la turtle
-    glm::vec3 up;
-    glm::vec3 forward;
-    glm::vec3 right;
+    float step;
+    // Fattori accumulati da '!' (raggio) e '%' (lunghezza)
+    float radius_scale;
+    float length_scale;
+};
 
-    // Per scala
-    glm::mat4 scale_matrix;
+// Operazioni della turtle dopo l'ottimizzazione: solo quelle che producono geometria o cambiano stato
+enum class TurtleOpKind : uint8_t {
+    Branch,
+    Leaf,
+    Junction,
+    Rotate,
+    Scale,
+    Push,
+    Pop
+};
 
-    float step;
-    float radius;
+// Record compatto di un modulo: trasformazione rigida e scala per asse, 40 byte invece di mat4 + char
+struct ModuleInstance {
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 scale;
+};
+
+// Moduli di un albero separati per tipo (indice TurtleOpKind::Branch, Leaf, Junction),
+// ciascuno nell'ordine in cui la turtle li produce
+constexpr size_t MODULE_KINDS = 3;
+using ModuleCounts = std::array<uint64_t, MODULE_KINDS>;
+
+struct TreeModules {
+    std::array<std::vector<ModuleInstance>, MODULE_KINDS> kinds;
+    // Scatola dello scheletro: inizio e fine dei rami col loro raggio, giunzioni e attacchi delle
+    // foglie. La geometria delle foglie non è compresa (vedi Tree::getBounds)
+    Bounds bounds;
+
+    std::vector<ModuleInstance> &of(TurtleOpKind kind) {
+        return kinds[static_cast<size_t>(kind)];
+    }
+    [[nodiscard]] const std::vector<ModuleInstance> &of(TurtleOpKind kind) const {
+        return kinds[static_cast<size_t>(kind)];
+    }
+    [[nodiscard]] size_t size() const {
+        return kinds[0].size() + kinds[1].size() + kinds[2].size();
+    }
+    void clear() {
+        for (auto &kind : kinds) {
+            kind.clear();
+        }
+        bounds = Bounds{};
+    }
+};
+
+inline bool is_module(TurtleOpKind kind) {
+    return static_cast<size_t>(kind) < MODULE_KINDS;
+}
+
+struct TurtleOp {
+    TurtleOpKind kind;
+    // Ripetizioni di moduli, push e pop, oppure applicazioni di '%' per Scale
+    uint32_t count;
+    // Rotazione composta (Rotate) e fattore sul raggio (Scale)
+    glm::quat rotation;
+    float radius_scale;
+};
+
+// Sottoalbero interpretato da un worker: stato all'ingresso, operazioni (Push, Pop) e offset in uscita
+struct TurtleTask {
+    TurtleState entry;
+    uint32_t push;
+    uint32_t pop;
+    ModuleCounts out;
+};
+
+// Memoria di lavoro fornita dal chiamante, una per thread: stack e lista di operazioni sono
+// contigui e, riutilizzati tra alberi, smettono presto di allocare
+struct TurtleScratch {
+    std::vector<TurtleState> stack;
+    std::vector<TurtleOp> ops;
+    // Per ogni '[' aperto: indice della sua Push e se il ramo ha prodotto geometria
+    std::vector<std::pair<size_t, bool>> branches;
+
+    // Struttura delle parentesi per l'interpretazione parallela: Pop corrispondente a ogni Push
+    // e numero di moduli prima di ogni operazione
+    std::vector<uint32_t> match;
+    std::vector<ModuleCounts> modules_before;
+    std::vector<TurtleTask> tasks;
+    std::vector<std::vector<TurtleState>> task_stacks;
+    std::vector<Bounds> group_bounds;
+};
+
+class Interpreter;
+
+// Ottimizzatore a finestra che riceve i token dell'espansione e scrive la lista di operazioni.
+// Unisce rotazioni consecutive in un solo quaternione e le scale in un solo Scale, scarta
+// rotazioni e scale prima di ']' e i rami che non producono geometria, e trasforma 'X' in 'F'
+class TurtleOptimizer {
+public:
+    TurtleOptimizer(const Interpreter &interpreter, TurtleScratch &scratch);
+
+    // Simbolo ripetuto count volte (vedi token_stream.h)
+    void feed(char c, unsigned int count = 1);
+    // Restituisce la lista completa, valida fino al prossimo uso dello scratch
+    const std::vector<TurtleOp> &finish();
+private:
+    void flush();
+    void module(TurtleOpKind kind, unsigned int count);
+    void clear_pending();
+
+    static constexpr int8_t NO_AXIS = -1;
+    static constexpr int8_t MIXED_AXES = 3;
+
+    const Interpreter &interpreter;
+    TurtleScratch &scratch;
+    glm::quat pending_rotation;
+    // Asse delle rotazioni in sospeso (0 Z, 1 X, 2 Y) e giri netti attorno a esso: una rotazione
+    // si scarta solo se si annulla esattamente, cioè su un solo asse con giri netti nulli
+    int8_t pending_axis = NO_AXIS;
+    int64_t pending_turns = 0;
+    float pending_radius = 1.0f;
+    uint32_t pending_length = 0;
+};
+
+// Cursore su un singolo albero (o sottoalbero): esegue le operazioni e scrive moduli e
+// trasformazioni in un intervallo già dimensionato dal chiamante
+class Turtle {
+public:
+    Turtle(const Interpreter &interpreter, std::vector<TurtleState> &stack, const std::array<ModuleInstance *, MODULE_KINDS> &out, const TurtleState &start);
+
+    void run(const TurtleOp *begin, const TurtleOp *end);
+    void run(const TurtleOp &op);
+    // Lascia spazio per i moduli scritti da qualcun altro
+    void skip(const ModuleCounts &n);
+
+    [[nodiscard]] const TurtleState &current() const {
+        return state;
+    }
+    // Scatola dei moduli scritti da questo cursore
+    [[nodiscard]] const Bounds &bounds() const {
+        return box;
+    }
+private:
+    void emit(TurtleOpKind kind, const glm::vec3 &scale, unsigned int count);
+
+    const Interpreter &interpreter;
+    std::vector<TurtleState> &stack;
+    std::array<ModuleInstance *, MODULE_KINDS> out;
+    TurtleState state;
+    Bounds box;
 };
 
+// Parametri immutabili dell'interpretazione: lo stesso Interpreter può servire più thread insieme
 class Interpreter {
 public:
-    explicit Interpreter(float angle = 10.0f, glm::vec3 position = glm::vec3(0.0f), float radius = 0.1f, float length = 1.0f, float radius_decay = 0.9f, float length_decay = 0.9f);
+    explicit Interpreter(float angle = 10.0f, float radius = 0.1f, float length = 1.0f, float radius_decay = 0.9f, float length_decay = 0.9f);
     ~Interpreter() = default;
 
-    void read_string(const std::string & predicate, std::vector<char>& models, std::vector<glm::mat4> & transforms);
-    void reset_interpreter(glm::vec3 position = glm::vec3(0.0f));
+    // La stringa è in formato token (vedi token_stream.h): viene ottimizzata e poi eseguita
+    void read_string(const std::string & predicate, TurtleScratch &scratch, TreeModules &modules, glm::vec3 position = glm::vec3(0.0f), WorkerPool *pool = nullptr) const;
+
+    // Accoda a modules i moduli prodotti dalle operazioni. Con un pool, gli alberi grandi vengono
+    // divisi in sottoalberi interpretati in parallelo: il risultato è identico a quello seriale
+    void run(const std::vector<TurtleOp> &ops, TurtleScratch &scratch, TreeModules &modules, glm::vec3 position = glm::vec3(0.0f), WorkerPool *pool = nullptr) const;
+
+    static ModuleCounts count_modules(const std::vector<TurtleOp> &ops);
+
+    [[nodiscard]] TurtleState initial_state(glm::vec3 position) const;
 private:
+    friend class Turtle;
+    friend class TurtleOptimizer;
+
     float init_radius, init_length;
     float length_decay, radius_decay;
-
-    TurtleState state;
-    std::stack<TurtleState> state_stack;
     float angle;
+
+    // Rotazioni '+', '-', '&', '^', '/', '(' attorno agli assi locali, precalcolate per ogni
+    // numero di ripetizioni di un token: rotations[asse][k - 1] ruota di k angoli
+    static constexpr unsigned int ROTATIONS = 6;
+    std::array<std::array<glm::quat, MAX_TOKEN_RUN>, ROTATIONS> rotations;
+
+    // Sotto questa soglia di moduli l'interpretazione resta seriale
+    static constexpr size_t PARALLEL_MODULES = 1 << 14;
+    static constexpr size_t MIN_TASK_MODULES = 1 << 10;
+
+    // Restituisce la scatola di tutti i moduli scritti
+    Bounds run_parallel(const std::vector<TurtleOp> &ops, TurtleScratch &scratch, const std::array<ModuleInstance *, MODULE_KINDS> &out, const TurtleState &start, size_t total, WorkerPool &pool) const;
 };
 
 
@@ -4,29 +4,295 @@
 
 #ifndef LINDENMAYER_H
 #define LINDENMAYER_H
+#include <array>
+#include <cstdint>
 #include <map>
+#include <random>
 #include <set>
 #include <string>
 #include <vector>
 
+#include "token_stream.h"
+#include "worker_pool.h"
+
+// Successore: intervallo contiguo di token dentro l'arena delle produzioni
+struct Successor {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// Regola stocastica compilata in una alias table (metodo di Vose): estrazione in O(1).
+// count == 0 indica la produzione identità
+struct CompiledRule {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+// Previsione della crescita della stringa prima di generarla
+struct GrowthEstimate {
+    double expected_length = 0;
+    double worst_length = 0;
+    double expected_branches = 0;
+    double expected_leaves = 0;
+    double expected_junctions = 0;
+    double worst_modules = 0;
+
+    [[nodiscard]] double expected_modules() const {
+        return expected_branches + expected_leaves + expected_junctions;
+    }
+};
 
 class Lindenmayer {
 public:
-    explicit Lindenmayer(const std::map<char, std::map<std::string, float>> &production_rules)
-        : production_rules(production_rules) {
-    }
+    explicit Lindenmayer(const std::map<char, std::map<std::string, float>> &production_rules, uint64_t seed = std::random_device{}());
 
-    std::string extract_rule(const std::map<std::string, float>& stochastic_rule);
+    void seed(uint64_t seed);
 
-    std::string iterate(const std::string &current_string);
+    // Con un pool le stringhe lunghe vengono riscritte in parallelo, nullptr torna al percorso seriale
+    void set_worker_pool(WorkerPool *worker_pool);
 
-    std::string cleanup(const std::string &current_string);
+    // Cache delle espansioni deterministiche usata da expand, condivisa tra tutti gli alberi
+    void set_memoization(bool enabled);
 
-    std::string generate(const std::string &axiom, unsigned int n_iterations, bool need_cleanup = false);
+    // Indice del successore estratto relativo alla regola, dato un numero casuale a 64 bit
+    uint8_t extract_rule(const CompiledRule &stochastic_rule, uint64_t r) const;
+
+    // Le stringhe sono in formato token (vedi token_stream.h) e la posizione è quella del simbolo decodificato.
+    // Il risultato dipende solo da (stream, iterazione, posizione): seriale e parallelo coincidono
+    void iterate(const std::string &current_string, std::string &next_string, uint64_t stream, uint32_t iteration);
+
+    // Lunghezza e numero di moduli (F/L/J) attesi e nel caso peggiore, dai pesi delle regole
+    [[nodiscard]] GrowthEstimate estimate(const std::string &axiom, unsigned int n_iterations) const;
+    static bool is_module(char c);
+
+    // Il risultato, in formato token, resta valido fino alla prossima chiamata
+    const std::string &generate(const std::string &axiom, unsigned int n_iterations);
+
+    // Espansione in profondità: passa la stringa finale a sink(char, ripetizioni) senza costruirla.
+    // Usa lo stesso stream di generate, quindi a parità di seed produce la stessa sequenza
+    template<typename Sink>
+    void expand(const std::string &axiom, unsigned int n_iterations, Sink &&sink);
+
+    // Derivazione incrementale per albero: i livelli già calcolati restano in cache, quindi N+1 costa
+    // una sola passata di iterate e N-1 è immediato. Oltre il budget si espande in profondità
+    // dall'ultimo livello in cache. Lo stream dell'albero i è l'i-esima estrazione dopo seed()
+    template<typename Sink>
+    void derive(size_t tree, const std::string &axiom, unsigned int n_iterations, Sink &&sink);
+
+    void set_cache_budget(size_t bytes);
+    [[nodiscard]] size_t cached_bytes() const {
+        return cache_bytes;
+    }
 private:
-    std::map<char, std::map<std::string, float>> production_rules;
+    static constexpr uint8_t IDENTITY = 0xFF;
+    static constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+    static constexpr double RESERVE_LIMIT = 256.0 * (1 << 20);
+    // Un buffer che supera di tanto la lunghezza attesa viene liberato, sotto RELEASE_MIN si tiene
+    static constexpr size_t RELEASE_FACTOR = 4;
+    static constexpr size_t RELEASE_MIN = 1 << 20;
+    static void release_oversized(std::string &buffer, size_t expected);
+
+    static uint64_t counter_random(uint64_t stream, uint32_t iteration, uint64_t position);
+
+    // Riscrive i token in [begin, end) partendo dal simbolo decodificato position. Con un TokenWriter
+    // senza buffer conta i byte, con il buffer li scrive: le estrazioni non hanno stato, quindi coincidono
+    template<typename Writer>
+    void rewrite(const std::string &current_string, size_t begin, size_t end, uint64_t stream, uint32_t iteration,
+                 uint64_t position, Writer &writer) const;
+    static size_t align(const std::string &current_string, size_t i);
+
+    void compile_rule(unsigned char symbol, const std::map<std::string, float> &stochastic_rule);
+    void find_deterministic();
+
+    // Espansione di (simbolo, profondità rimanente) per simboli il cui sottoalbero non contiene scelte
+    // stocastiche, come DAG: ogni parte del successore è un token da emettere o count copie del nodo
+    // figlio a profondità - 1, condiviso tra tutti i padri. levels[j] conta i simboli che il sottoalbero
+    // occupa al livello relativo j (1 <= j < depth)
+    struct MemoPart {
+        char op;
+        unsigned int count;
+        int32_t child;
+    };
+    struct MemoNode {
+        uint32_t first;
+        uint32_t count;
+        uint32_t levels;
+    };
+    static constexpr size_t MEMO_PART_LIMIT = 1 << 20;
+    static constexpr int32_t UNKNOWN = -1;
+    static constexpr int32_t TOO_LARGE = -2;
+
+    const MemoNode *memo(unsigned char symbol, uint32_t depth);
+    int32_t memo_index(unsigned char symbol, uint32_t depth);
+
+    template<typename Sink>
+    void expand_from(const std::string &start, uint32_t start_level, unsigned int n_iterations, uint64_t stream,
+                     Sink &&sink);
+
+    // Calcola (e se c'è spazio mette in cache) i livelli dell'albero fino a n_iterations.
+    // Restituisce il livello più profondo disponibile, in cache o nel buffer back
+    const std::string &advance(size_t tree, const std::string &axiom, unsigned int n_iterations, uint32_t &level);
+    // Assioma in formato token, ricodificato solo quando cambia
+    const std::string &encoded_axiom(const std::string &axiom);
+
+    // Tabella indicizzata direttamente dal simbolo
+    std::array<CompiledRule, 256> rules{};
+    std::vector<Successor> successors;
+    std::vector<float> probability;
+    std::vector<float> weight;
+    std::vector<uint32_t> alias;
+    // Tutti i successori concatenati
+    std::string arena;
+
+    std::mt19937_64 rng;
+    WorkerPool *pool = nullptr;
+
+    std::array<bool, 256> deterministic{};
+    bool memoization = false;
+    std::vector<int32_t> memo_lookup;
+    std::vector<MemoNode> memo_nodes;
+    std::vector<MemoPart> memo_parts;
+    std::vector<uint64_t> memo_levels;
+
+    // Buffer ping-pong e confini dei blocchi paralleli, riutilizzati tra iterazioni e alberi
+    std::string front, back;
+    std::vector<size_t> chunk_bounds;
+    std::vector<uint64_t> chunk_positions;
+    std::vector<size_t> chunk_offsets;
+
+    // Frame (token ancora da espandere, livello, ripetizioni rimaste del token corrente)
+    // e posizione raggiunta su ogni livello
+    struct Frame {
+        const char *cursor;
+        const char *end;
+        uint32_t level;
+        char op;
+        unsigned int pending;
+    };
+    std::vector<Frame> frames;
+    std::vector<uint64_t> level_position;
+    // Visita di un nodo memoizzato: parti ancora da emettere e copie rimaste del figlio corrente
+    struct MemoFrame {
+        uint32_t next;
+        uint32_t end;
+        unsigned int pending;
+    };
+    std::vector<MemoFrame> memo_frames;
+
+    // Stato di derivazione per albero: lo stream contatore è tutto lo stato casuale che serve
+    struct TreeDerivation {
+        uint64_t stream;
+        std::vector<std::string> levels;
+    };
+    std::vector<TreeDerivation> trees;
+    std::string axiom_symbols, axiom_tokens;
+    size_t cache_bytes = 0;
+    size_t cache_budget = 256 << 20;
 };
 
+template<typename Sink>
+void Lindenmayer::expand(const std::string &axiom, unsigned int n_iterations, Sink &&sink) {
+    expand_from(encoded_axiom(axiom), 0, n_iterations, rng(), sink);
+}
+
+template<typename Sink>
+void Lindenmayer::derive(size_t tree, const std::string &axiom, unsigned int n_iterations, Sink &&sink) {
+    uint32_t level;
+    const std::string &start = advance(tree, axiom, n_iterations, level);
+    if (level == n_iterations) {
+        char op;
+        unsigned int count;
+        for (size_t i = 0; i < start.size();) {
+            i += read_token(start.data() + i, op, count);
+            sink(op, count);
+        }
+        return;
+    }
+    expand_from(start, level, n_iterations, trees[tree].stream, sink);
+}
+
+template<typename Sink>
+void Lindenmayer::expand_from(const std::string &start, uint32_t start_level, unsigned int n_iterations, uint64_t stream,
+                              Sink &&sink) {
+    // Lo stack non supera mai n_iterations + 1 frame: memoria O(profondità)
+    frames.clear();
+    frames.push_back({start.data(), start.data() + start.size(), start_level, 0, 0});
+    level_position.assign(n_iterations + 1, 0);
+
+    while (!frames.empty()) {
+        Frame &top = frames.back();
+        if (top.pending == 0) {
+            if (top.cursor == top.end) {
+                frames.pop_back();
+                continue;
+            }
+            top.cursor += read_token(top.cursor, top.op, top.pending);
+        }
+        const char c = top.op;
+        const uint32_t level = top.level;
+        if (level == n_iterations) {
+            sink(c, top.pending);
+            top.pending = 0;
+            continue;
+        }
+
+        const CompiledRule &rule = rules[static_cast<unsigned char>(c)];
+        if (memoization && deterministic[static_cast<unsigned char>(c)]) {
+            if (const MemoNode *node = memo(static_cast<unsigned char>(c), n_iterations - level)) {
+                // Sottoalbero già noto: avanza i contatori dei livelli e lo emette visitando il DAG,
+                // una volta per ripetizione
+                const unsigned int repeat = top.pending;
+                top.pending = 0;
+                level_position[level] += repeat;
+                for (uint32_t j = 1; level + j < n_iterations; j++) {
+                    level_position[level + j] += repeat * memo_levels[node->levels + j - 1];
+                }
+                for (unsigned int r = 0; r < repeat; r++) {
+                    memo_frames.push_back({node->first, node->first + node->count, 0});
+                    while (!memo_frames.empty()) {
+                        MemoFrame &f = memo_frames.back();
+                        if (f.next == f.end) {
+                            memo_frames.pop_back();
+                            continue;
+                        }
+                        const MemoPart &part = memo_parts[f.next];
+                        if (part.child < 0) {
+                            sink(part.op, part.count);
+                            f.next++;
+                            continue;
+                        }
+                        if (f.pending == 0) {
+                            f.pending = part.count;
+                        }
+                        if (--f.pending == 0) {
+                            f.next++;
+                        }
+                        const MemoNode &child = memo_nodes[part.child];
+                        memo_frames.push_back({child.first, child.first + child.count, 0});
+                    }
+                }
+                continue;
+            }
+        }
+        if (rule.count != 0) {
+            // La posizione del simbolo nella stringa del suo livello è quella che userebbe iterate
+            top.pending--;
+            const uint64_t position = level_position[level]++;
+            const Successor &s = successors[rule.first + extract_rule(rule, counter_random(stream, level, position))];
+            frames.push_back({arena.data() + s.offset, arena.data() + s.offset + s.length, level + 1, 0, 0});
+        }
+        else {
+            // Produzione identità: la ripetizione occupa le sue posizioni in ogni livello successivo
+            const unsigned int repeat = top.pending;
+            top.pending = 0;
+            for (uint32_t l = level; l < n_iterations; l++) {
+                level_position[l] += repeat;
+            }
+            sink(c, repeat);
+        }
+    }
+}
+
 
 
 #endif //LINDENMAYER_H
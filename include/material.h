@@ -0,0 +1,54 @@
+//
+// Created by Niccolo on 01/07/2025.
+//
+
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+
+enum class TextureKind : uint8_t {
+    Diffuse,
+    Specular,
+    Normal,
+    Height,
+    Cubemap
+};
+
+struct Texture {
+    unsigned int id;
+    TextureKind kind = TextureKind::Diffuse;
+};
+
+// Ogni tipo ha un intervallo fisso di unità: l'n-esima texture di un tipo va nell'unità
+// TEXTURE_UNIT_BASE[tipo] + n. Gli shader fissano i sampler sugli stessi numeri con layout(binding = ...)
+// (texture_diffuse1 → 0, texture_specular1 → 4, texture_normal1 → 6, cubemap → 10)
+inline constexpr std::array<GLuint, 5> TEXTURE_UNIT_BASE = {0, 4, 6, 8, 10};
+inline constexpr std::array<GLuint, 5> TEXTURE_UNIT_COUNT = {4, 2, 2, 2, 1};
+
+// Insieme di texture con le unità già risolte: collegarlo è una sola glBindTextures
+class Material {
+public:
+    Material() = default;
+    explicit Material(std::vector<Texture> textures);
+
+    // Collega le texture alle loro unità; le unità intermedie non usate vengono liberate
+    void bind() const;
+
+    [[nodiscard]] const std::vector<Texture> &textures() const {
+        return source;
+    }
+    [[nodiscard]] bool empty() const {
+        return source.empty();
+    }
+private:
+    std::vector<Texture> source;
+    // Nomi per le unità first, first + 1, ... (0 dove il materiale non ha texture)
+    GLuint first = 0;
+    std::vector<GLuint> units;
+};
+
+#endif //MATERIAL_H
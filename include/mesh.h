@@ -10,7 +10,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include "shader.h"
+#include "bounds.h"
+#include "material.h"
 
 
 struct Vertex {
@@ -20,22 +21,20 @@ struct Vertex {
 
 };
 
-struct Texture {
-    unsigned int id;
-    std::string type;
-};
-
 class Mesh {
 public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    Material material;
     unsigned int VAO;
 
     Mesh() = default;
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture>textures);
-    void render(const Shader &shader) const;
+    // Un bind del VAO, uno delle texture e una draw
+    void render() const;
     auto getHeight(float x, float z) const -> float;
+    // Scatola dei vertici in coordinate del modello
+    [[nodiscard]] Bounds getBounds() const;
 private:
     unsigned int VBO, EBO;
     void setupMesh();
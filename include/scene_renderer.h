@@ -0,0 +1,182 @@
+//
+// Created by Niccolo on 24/06/2025.
+//
+
+#ifndef SCENE_RENDERER_H
+#define SCENE_RENDERER_H
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "frame_uniforms.h"
+#include "geometry_arena.h"
+#include "interpreter.h"
+#include "mesh.h"
+#include "shader.h"
+#include "spatial_index.h"
+#include "tree.h"
+
+// Disegna terreno, muri e foresta da un'unica arena di geometria: un passaggio per materiale
+// (corteccia, foglie, terreno, muri), ciascuno con una sola glMultiDrawElementsIndirect.
+// Il costo di invio non dipende dal numero di alberi né di mesh diverse. Gli alberi cotti
+// sono un comando per variante e livello di dettaglio, istanziato sulle posizioni che lo usano;
+// gli altri un comando per albero e tipo di modulo, così il culling azzera solo le istanze
+class SceneRenderer {
+public:
+    SceneRenderer() = default;
+    ~SceneRenderer();
+
+    SceneRenderer(const SceneRenderer &) = delete;
+    SceneRenderer &operator=(const SceneRenderer &) = delete;
+
+    // origins[i] è la base dell'albero i sul terreno, tree_scale la scala uniforme di ogni albero.
+    // Da chiamare solo quando la foresta o il terreno cambiano
+    void upload(const std::vector<Tree> &forest, const std::vector<glm::vec3> &origins, float tree_scale,
+                const Mesh &terrain, const Mesh &wall, const std::vector<ArenaInstance> &walls);
+    // Dopo upload: disegna ogni variante cotta da IMPOSTOR_VIEWS direzioni in un atlante (colore e normali).
+    // Lo shader è quello degli alberi con impostor_bake.frag, alpha_discard già impostato. Le viste
+    // passano per FrameData, che alla fine torna com'era
+    void bakeImpostors(Shader &shader, FrameUniforms &frame);
+
+    // Scarta alberi, muri e terreno fuori dal frustum e sceglie il livello di ogni albero cotto
+    // visibile dalla dimensione proiettata in pixel, con isteresi.
+    // pixels_per_unit è l'altezza del viewport divisa per 2 tan(fov / 2)
+    void updateVisibility(const glm::vec3 &eye, const Frustum &frustum, float pixels_per_unit);
+
+    // Uniform impostati da renderImpostors, risolti una volta dopo il link del programma
+    void resolveUniforms(const Shader &impostors);
+
+    // Il programma lo attiva il chiamante, i sampler sono fissati negli shader. Solo renderImpostors
+    // imposta uniform, quelli risolti da resolveUniforms
+    void renderTerrain() const;
+    void renderTrees() const;
+    void renderImpostors() const;
+    void renderWalls() const;
+
+    // Moduli disegnati come istanze, esclusi quelli degli alberi cotti
+    [[nodiscard]] size_t instances(TurtleOpKind kind) const {
+        return counts[static_cast<size_t>(kind)];
+    }
+    // Varianti cotte distinte caricate nell'arena
+    [[nodiscard]] size_t bakedVariants() const {
+        return variants.size();
+    }
+    // Alberi cotti disegnati a un livello nell'ultimo frame: 0 completo, 1 ridotto, 2 impostor
+    [[nodiscard]] size_t treesAtLevel(size_t level) const {
+        return level_counts[level];
+    }
+    // Alberi (cotti e non) fuori dal frustum nell'ultimo frame
+    [[nodiscard]] size_t culledTrees() const {
+        return culled;
+    }
+    // Indice della foresta sul piano XZ: l'id di ogni sfera è l'indice dell'albero in forest
+    [[nodiscard]] const SpatialIndex &spatialIndex() const {
+        return index;
+    }
+    // Albero la cui sfera è colpita per prima dal raggio, direction normalizzata
+    [[nodiscard]] std::optional<size_t> pickTree(const glm::vec3 &origin, const glm::vec3 &direction) const;
+
+    static constexpr size_t LOD_LEVELS = BAKED_LEVELS + 1;
+private:
+    // Soglie in pixel tra un livello e il successivo e margine relativo per non alternare i livelli
+    static constexpr std::array<float, LOD_LEVELS - 1> LOD_PIXELS = {300.0f, 80.0f};
+    static constexpr float LOD_HYSTERESIS = 0.15f;
+    // Atlante degli impostor: una riga di viste attorno all'asse Y per layer.
+    // Oltre MAX_IMPOSTOR_LAYERS varianti gli impostor vengono riusati: da lontano gli alberi si somigliano
+    static constexpr int IMPOSTOR_TILE = 64;
+    static constexpr int IMPOSTOR_VIEWS = 8;
+    static constexpr size_t MAX_IMPOSTOR_LAYERS = 256;
+
+    // Partizione delle istanze di una variante: un gruppo per livello e in coda gli alberi scartati
+    static constexpr uint8_t CULLED_SLOT = LOD_LEVELS;
+    struct LodVariant {
+        std::shared_ptr<const BakedTree> tree;
+        // Istanze [base, base + count) nell'arena, ordinate per gruppo
+        uint32_t base;
+        uint32_t count;
+        // Il gruppo g occupa [start[g], start[g + 1]) relativo a base
+        std::array<uint32_t, LOD_LEVELS + 2> start;
+        bool changed;
+        std::array<ArenaRange, BAKED_MATERIALS> full;
+        std::array<size_t, BAKED_LEVELS> bark_commands;
+        std::array<size_t, BAKED_LEVELS> leaf_commands;
+    };
+    struct LodTree {
+        uint32_t variant;
+        // Posizione in lod_instances
+        uint32_t position;
+        // Ultimo livello scelto (resta anche da scartato, per l'isteresi) e gruppo attuale
+        uint8_t level;
+        uint8_t slot;
+    };
+    // Albero disegnato modulo per modulo: un comando per tipo sulle sue istanze
+    struct ModuleTree {
+        std::array<size_t, MODULE_KINDS> commands;
+        std::array<uint32_t, MODULE_KINDS> base;
+        std::array<uint32_t, MODULE_KINDS> count;
+    };
+
+    void releaseImpostors();
+    // Istanze di un albero non cotto (slot in tree_spheres) accese o spente; niente per quelli cotti
+    void showModuleTree(uint32_t slot, bool visible);
+    // Sposta l'albero t nel gruppo slot della sua variante: uno scambio per confine attraversato
+    void moveLodTree(size_t t, uint8_t slot);
+    void swapLodInstances(uint32_t a, uint32_t b);
+
+    GeometryArena arena;
+    IndirectPass bark, leaves, terrain, walls, impostors;
+
+    // Materiale di ogni passaggio: rami e giunzioni condividono la corteccia
+    Material bark_material, leaf_material, terrain_material, wall_material, impostor_material;
+    std::array<size_t, MODULE_KINDS> counts{};
+    std::vector<ArenaInstance> staging;
+
+    // Alberi cotti raggruppati per variante, nello stesso ordine delle loro istanze
+    std::vector<LodVariant> variants;
+    std::vector<LodTree> lod_trees;
+    std::vector<ModuleTree> module_trees;
+    // Copia del blocco di istanze degli alberi cotti, da lod_base: lod_at[p] è l'albero in posizione p.
+    // A ogni frame si carica solo l'intervallo [lod_dirty_first, lod_dirty_last) toccato dagli scambi
+    std::vector<ArenaInstance> lod_instances;
+    std::vector<uint32_t> lod_at;
+    std::vector<uint32_t> changed_variants;
+    uint32_t lod_dirty_first = UINT32_MAX, lod_dirty_last = 0;
+    uint32_t lod_base = 0;
+    uint32_t identity_instance = 0;
+    float scale = 1.0f;
+    std::array<size_t, LOD_LEVELS> level_counts{};
+
+    // Sfere in coordinate mondo: prima gli alberi cotti nell'ordine di lod_trees, poi module_trees.
+    // tree_slot[i] è la posizione dell'albero i della foresta in tree_spheres
+    SphereSet tree_spheres;
+    std::vector<uint32_t> tree_slot;
+    std::vector<uint8_t> tree_visible;
+    // Sopravvive agli upload: gli alberi vengono aggiornati, non reinseriti
+    SpatialIndex index;
+    std::vector<uint32_t> visible_ids;
+    // Posizioni in tree_spheres visibili nel frame precedente e in quello attuale, e ultimo frame
+    // in cui ogni albero è stato visto: il culling tocca solo chi entra o esce dal frustum
+    std::vector<uint32_t> visible_slots, next_visible_slots;
+    std::vector<uint32_t> seen_frame;
+    uint32_t visibility_frame = 0;
+    size_t culled = 0;
+    Bounds terrain_bounds;
+    bool terrain_visible = true;
+    // Un comando per muro, con la sua scatola in coordinate mondo
+    std::vector<Bounds> wall_bounds;
+    std::vector<size_t> wall_commands;
+    uint32_t wall_base = 0;
+
+    ArenaRange impostor_quad{};
+    unsigned int impostorAlbedo = 0, impostorNormals = 0, impostorBounds = 0;
+    int impostor_layers = 0;
+
+    UniformHandle<int> impostor_views, impostor_layer_count;
+};
+
+#endif //SCENE_RENDERER_H
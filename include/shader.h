@@ -10,11 +10,25 @@
 #include <glad/glad.h>
 
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <unordered_map>
 #include <glm/glm.hpp>
 
+// Uniform risolto una volta: impostarlo è solo la chiamata glUniform*, senza stringhe né ricerche.
+// Il tipo impedisce di passare un valore sbagliato; con location -1 (uniform assente o scartato
+// dal linker) OpenGL ignora la chiamata, come faceva glGetUniformLocation
+template<typename T>
+struct UniformHandle {
+    GLint location = -1;
+
+    [[nodiscard]] bool valid() const {
+        return location >= 0;
+    }
+};
+
 class Shader {
 public:
     // Program ID
@@ -29,13 +43,44 @@ public:
     // delete shader
     void unuse();
 
-    // Utils
-    void setBool(const std::string& name, bool value) const;
-    void setInt(const std::string& name, int value) const;
-    void setFloat(const std::string& name, float value) const;
-    void setVec3(const std::string& name, const glm::vec3& value) const;
-    void setMat4(const std::string& name, const glm::mat4& mat) const;
-    void setVec3(const std::string& str, float x, float y, float z)const;
+    // Location di un uniform attivo dalla cache riempita al link, -1 se non esiste.
+    // Gli array sono registrati sia col nome base sia elemento per elemento ("a", "a[0]", "a[1]", ...)
+    [[nodiscard]] GLint location(std::string_view name) const;
+    template<typename T>
+    [[nodiscard]] UniformHandle<T> uniform(std::string_view name) const {
+        return {location(name)};
+    }
+
+    // Valgono per il programma in uso, come glUniform*
+    static void set(UniformHandle<bool> handle, bool value);
+    static void set(UniformHandle<int> handle, int value);
+    static void set(UniformHandle<float> handle, float value);
+    static void set(UniformHandle<glm::vec3> handle, const glm::vec3 &value);
+    static void set(UniformHandle<glm::vec4> handle, const glm::vec4 &value);
+    static void set(UniformHandle<glm::mat4> handle, const glm::mat4 &value);
+
+    // Utils: cercano il nome nella cache a ogni chiamata, per uniform impostati di rado
+    void setBool(std::string_view name, bool value) const;
+    void setInt(std::string_view name, int value) const;
+    void setFloat(std::string_view name, float value) const;
+    void setVec3(std::string_view name, const glm::vec3& value) const;
+    void setVec4(std::string_view name, const glm::vec4& value) const;
+    void setMat4(std::string_view name, const glm::mat4& mat) const;
+    void setVec3(std::string_view name, float x, float y, float z) const;
+private:
+    // Hash trasparente: la ricerca con string_view non costruisce una std::string
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    // Sostituisce ogni riga #include "file" con il contenuto del file, relativo a path
+    static std::string resolveIncludes(const std::string &source, const std::string &path, int depth = 0);
+    void reflectUniforms();
+
+    std::unordered_map<std::string, GLint, NameHash, std::equal_to<>> uniforms;
 };
 
 
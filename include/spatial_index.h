@@ -0,0 +1,109 @@
+//
+// Created by Niccolo on 29/06/2025.
+//
+
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+// Quadtree "loose" sul piano XZ per sfere identificate da un id (per la foresta, l'indice dell'albero).
+// I nodi sono una piramide implicita: il livello d ha 2^d × 2^d celle e una sfera finisce nella cella
+// più profonda che la contiene una volta allargata di mezza cella per lato, scelta dal centro e dal
+// raggio senza scendere l'albero. Spostare una sfera costa O(1) e non richiede di ricostruire l'indice.
+// Le sfere di ogni nodo sono in forma di struttura di array, testate quattro alla volta
+class SpatialIndex {
+public:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    struct Hit {
+        uint32_t id;
+        float distance;
+    };
+
+    SpatialIndex() = default;
+
+    // Svuota l'indice e lo dimensiona sulla scatola del mondo (ne conta solo XZ)
+    void reset(const Bounds &world, unsigned int depth = DEFAULT_DEPTH);
+    [[nodiscard]] const Bounds &world() const {
+        return world_bounds;
+    }
+
+    // Inserisce la sfera o, se l'id c'è già, la aggiorna spostandola solo se cambia cella
+    void update(uint32_t id, const glm::vec3 &center, float radius);
+    void remove(uint32_t id);
+    // Toglie tutti gli id >= count
+    void truncate(uint32_t count);
+    // Ricalcola le scatole dei nodi: update e remove le allargano soltanto
+    void refit();
+
+    // Accodano a out gli id delle sfere che intersecano il frustum o la sfera. La query sul frustum
+    // riusa un buffer interno: non va chiamata da più thread sullo stesso indice
+    void query(const Frustum &frustum, std::vector<uint32_t> &out) const;
+    void query(const glm::vec3 &center, float radius, std::vector<uint32_t> &out) const;
+    // Sfera più vicina colpita dal raggio entro max_distance; direction dev'essere normalizzata
+    [[nodiscard]] std::optional<Hit> raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                                             float max_distance = std::numeric_limits<float>::max()) const;
+
+    [[nodiscard]] size_t size() const {
+        return count;
+    }
+
+    static constexpr unsigned int DEFAULT_DEPTH = 6;
+    static constexpr unsigned int MAX_DEPTH = 10;
+private:
+    struct Node {
+        // Scatola delle sfere del sottoalbero, allargata a ogni inserimento (stretta solo da refit)
+        Bounds bounds;
+        // Sfere del nodo e loro id, nello stesso ordine
+        SphereSet spheres;
+        std::vector<uint32_t> ids;
+        // Sfere nel sottoalbero, per saltare i rami vuoti
+        uint32_t subtree = 0;
+    };
+    struct Slot {
+        uint32_t node = NONE;
+        uint32_t index = 0;
+    };
+    struct Cell {
+        unsigned int level;
+        uint32_t x, z;
+    };
+
+    [[nodiscard]] uint32_t node_index(const Cell &cell) const {
+        return level_start[cell.level] + cell.z * (1u << cell.level) + cell.x;
+    }
+    [[nodiscard]] Cell locate(uint32_t node) const;
+    [[nodiscard]] Cell cell_for(const glm::vec3 &center, float radius) const;
+    // Applica f al nodo e a tutti i suoi antenati fino alla radice
+    template<typename F>
+    void climb(Cell cell, F &&f);
+    void detach(uint32_t id);
+    void collect(uint32_t node, std::vector<uint32_t> &out) const;
+    void query(uint32_t node, const Frustum &frustum, std::vector<uint32_t> &out, std::vector<uint8_t> &scratch) const;
+    void query(uint32_t node, const glm::vec3 &center, float radius, std::vector<uint32_t> &out) const;
+    void raycast(uint32_t node, const glm::vec3 &origin, const glm::vec3 &inverse, const glm::vec3 &direction,
+                 std::optional<Hit> &best, float max_distance) const;
+
+    Bounds world_bounds;
+    // Angolo XZ e lato del quadrato che contiene il mondo
+    glm::vec2 origin{0.0f};
+    float side = 1.0f;
+    unsigned int levels = 0;
+    // Primo nodo di ogni livello: (4^d - 1) / 3
+    std::vector<uint32_t> level_start;
+    std::vector<Node> nodes;
+    std::vector<Slot> slots;
+    size_t count = 0;
+    // Esito del test delle sfere di un nodo, riusato tra una query e l'altra
+    mutable std::vector<uint8_t> cull_scratch;
+};
+
+#endif //SPATIAL_INDEX_H
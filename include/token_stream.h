@@ -0,0 +1,120 @@
+//
+// Created by Niccolo on 20/06/2025.
+//
+
+#ifndef TOKEN_STREAM_H
+#define TOKEN_STREAM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Formato compatto delle stringhe L-system come coppie (simbolo, ripetizioni).
+// Un byte ASCII è un simbolo singolo; un byte con il bit alto a 1 porta il numero di
+// ripetizioni (2..128) del simbolo che lo segue. Una stringa ASCII qualsiasi è già valida
+constexpr unsigned int MAX_TOKEN_RUN = 128;
+
+inline bool is_run_prefix(char b) {
+    return (static_cast<unsigned char>(b) & 0x80) != 0;
+}
+
+// Legge un token a partire da p e restituisce i byte consumati
+inline size_t read_token(const char *p, char &op, unsigned int &count) {
+    const auto b = static_cast<unsigned char>(*p);
+    if (b & 0x80) {
+        count = (b & 0x7F) + 1;
+        op = p[1];
+        return 2;
+    }
+    op = *p;
+    count = 1;
+    return 1;
+}
+
+// Byte occupati da un token di count ripetizioni (count <= MAX_TOKEN_RUN)
+inline size_t token_bytes(unsigned int count) {
+    return count == 0 ? 0 : count == 1 ? 1 : 2;
+}
+
+// Scrive token unendo le ripetizioni consecutive dello stesso simbolo. Con out == nullptr
+// conta soltanto i byte, così la stessa logica dimensiona il buffer e poi lo riempie
+struct TokenWriter {
+    char *out = nullptr;
+    // Offset del token ancora aperto, che può crescere finché non cambia simbolo
+    size_t open = 0;
+    char op = 0;
+    unsigned int count = 0;
+
+    void put(char c, unsigned int k) {
+        while (k > 0) {
+            if (count == 0 || c != op || count == MAX_TOKEN_RUN) {
+                open += token_bytes(count);
+                op = c;
+                count = 0;
+            }
+            const unsigned int add = std::min(k, MAX_TOKEN_RUN - count);
+            count += add;
+            k -= add;
+            if (out != nullptr) {
+                char *p = out + open;
+                if (count > 1) {
+                    *p++ = static_cast<char>(0x80 | (count - 1));
+                }
+                *p = op;
+            }
+        }
+    }
+
+    // Ricopia un intervallo già codificato
+    void put_tokens(const char *begin, const char *end) {
+        char c;
+        unsigned int k;
+        while (begin < end) {
+            begin += read_token(begin, c, k);
+            put(c, k);
+        }
+    }
+
+    [[nodiscard]] size_t size() const {
+        return open + token_bytes(count);
+    }
+};
+
+inline std::string encode_tokens(std::string_view symbols) {
+    TokenWriter counter;
+    for (char c : symbols) {
+        counter.put(c, 1);
+    }
+    std::string out(counter.size(), '\0');
+    TokenWriter writer{out.data()};
+    for (char c : symbols) {
+        writer.put(c, 1);
+    }
+    return out;
+}
+
+inline std::string decode_tokens(std::string_view tokens) {
+    std::string out;
+    char op;
+    unsigned int count;
+    for (size_t i = 0; i < tokens.size();) {
+        i += read_token(tokens.data() + i, op, count);
+        out.append(count, op);
+    }
+    return out;
+}
+
+// Numero di simboli rappresentati da un intervallo di token
+inline size_t token_symbols(const char *begin, const char *end) {
+    size_t symbols = 0;
+    char op;
+    unsigned int count;
+    while (begin < end) {
+        begin += read_token(begin, op, count);
+        symbols += count;
+    }
+    return symbols;
+}
+
+#endif //TOKEN_STREAM_H
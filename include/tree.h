@@ -9,20 +9,41 @@
 #include <vector>
 
 #include "branch_builder.h"
+#include "interpreter.h"
 #include "leaf_builder.h"
 #include "mesh.h"
+#include "tree_baker.h"
 
 
+// Moduli di un albero e mesh condivise con cui disegnarli: il disegno lo fa SceneRenderer
 class Tree {
 public:
-    Tree(const std::vector<glm::mat4> &transf, const std::vector<char> &mods, std::shared_ptr<Mesh> branch, std::shared_ptr<Mesh> leaf, std::shared_ptr<Mesh> junc);
-    void render(Shader &shader, const glm::mat4 &model = glm::mat4(1.0f));
+    Tree(TreeModules modules, std::shared_ptr<Mesh> branch, std::shared_ptr<Mesh> leaf, std::shared_ptr<Mesh> junc);
+
+    [[nodiscard]] const TreeModules &getModules() const {
+        return modules;
+    }
+    [[nodiscard]] const std::shared_ptr<Mesh> &getMesh(TurtleOpKind kind) const;
+    // Scatola dei moduli allargata della dimensione di una foglia, in coordinate dell'albero
+    [[nodiscard]] const Bounds &getBounds() const {
+        return bounds;
+    }
+
+    // Geometria cotta della variante, nullptr se l'albero si disegna modulo per modulo
+    [[nodiscard]] const std::shared_ptr<const BakedTree> &getBaked() const {
+        return baked;
+    }
+    void setBaked(std::shared_ptr<const BakedTree> tree) {
+        baked = std::move(tree);
+    }
 private:
-    std::vector<glm::mat4> transforms;
-    std::vector<char> model;
+    // Record compatti per tipo: la matrice di ogni modulo la ricostruisce il vertex shader
+    TreeModules modules;
     std::shared_ptr<Mesh> branch_ptr;
     std::shared_ptr<Mesh> leaf_ptr;
     std::shared_ptr<Mesh> junc_ptr;
+    std::shared_ptr<const BakedTree> baked;
+    Bounds bounds;
 };
 
 
@@ -0,0 +1,100 @@
+//
+// Created by Niccolo on 26/06/2025.
+//
+
+#ifndef TREE_BAKER_H
+#define TREE_BAKER_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bounds.h"
+#include "branch_sweeper.h"
+#include "interpreter.h"
+#include "mesh.h"
+
+// Materiali della geometria cotta: rami e giunzioni condividono la corteccia
+enum class BakedMaterial : uint8_t {
+    Bark,
+    Leaf
+};
+constexpr size_t BAKED_MATERIALS = 2;
+
+struct BakedGeometry {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Livelli di dettaglio cotti: mesh completa e mesh ridotta (anelli con meno lati, foglie accorpate).
+// Il terzo livello, l'impostor, lo ricava SceneRenderer dalla mesh completa
+constexpr size_t BAKED_LEVELS = 2;
+
+// Albero statico cotto in un solo vertex/index buffer per materiale e livello, in coordinate dell'albero.
+// Alberi con la stessa chiave sono la stessa variante e condividono la geometria
+struct BakedTree {
+    uint64_t key = 0;
+    std::array<std::array<BakedGeometry, BAKED_MATERIALS>, BAKED_LEVELS> levels;
+    // Scatola della mesh completa, per culling, scelta del livello e per inquadrare l'impostor
+    Bounds bounds;
+
+    [[nodiscard]] const BakedGeometry &of(BakedMaterial material, size_t level = 0) const {
+        return levels[level][static_cast<size_t>(material)];
+    }
+    [[nodiscard]] glm::vec3 center() const {
+        return bounds.center();
+    }
+    [[nodiscard]] float radius() const {
+        return bounds.radius();
+    }
+    [[nodiscard]] size_t bytes() const;
+};
+
+// Trasforma la geometria di ogni modulo nello spazio dell'albero, scarta le basi dei rami
+// (nascoste dalle giunzioni), salda i vertici coincidenti e toglie i triangoli degeneri.
+// Con swept la corteccia è fatta di tubi continui e le giunzioni non servono più; il livello
+// ridotto usa sempre i tubi, con metà dei lati.
+// Con una cartella di cache il risultato viene salvato su disco e riletto alla prossima esecuzione.
+// La cache è spenta di default: le chiavi dipendono dal seme della foresta, e con semi casuali
+// quasi nessun file verrebbe mai riletto. Ha senso solo con foreste a seme fisso
+class TreeBaker {
+public:
+    TreeBaker(const Mesh &branch, const Mesh &leaf, const Mesh &junction, const BranchSweeper &sweeper, bool swept,
+              std::string cache_dir = {});
+
+    // Chiave della variante: dipende dai moduli e dalla geometria dei moduli
+    [[nodiscard]] uint64_t key(const TreeModules &modules) const;
+    // Byte della geometria cotta (tutti i livelli) prima della saldatura, per decidere se cuocere l'albero
+    [[nodiscard]] size_t estimate(const TreeModules &modules) const;
+
+    // Legge la variante dalla cache o la cuoce (e la salva). Può essere chiamato da più thread
+    // purché le chiavi siano diverse
+    [[nodiscard]] std::shared_ptr<const BakedTree> bake(const TreeModules &modules, uint64_t key) const;
+
+private:
+    static constexpr uint32_t FORMAT_VERSION = 3;
+    // Divisore della risoluzione degli anelli nel livello ridotto
+    static constexpr unsigned int REDUCED_RESOLUTION_DIVISOR = 2;
+    // Le foglie del livello ridotto si accorpano in celle grandi quanto due foglie; la foglia che
+    // rappresenta la cella cresce con la radice del numero di foglie, fino a questo fattore
+    static constexpr float MAX_CARD_GROWTH = 2.0f;
+
+    [[nodiscard]] std::vector<ModuleInstance> merge_leaves(const std::vector<ModuleInstance> &leaves) const;
+
+    [[nodiscard]] std::string cache_path(uint64_t key) const;
+    [[nodiscard]] std::shared_ptr<BakedTree> load(uint64_t key) const;
+    void store(const BakedTree &tree) const;
+
+    // Geometria locale dei moduli già ripulita, per tipo (indice TurtleOpKind)
+    std::array<BakedGeometry, MODULE_KINDS> parts;
+    BranchSweeper sweeper;
+    BranchSweeper reduced;
+    bool swept;
+    float leaf_extent = 0.0f;
+    uint64_t parts_hash;
+    std::string cache_dir;
+};
+
+#endif //TREE_BAKER_H
@@ -12,7 +12,9 @@
 #include <map>
 #include <vector>
 
+#include "geometry_arena.h"
 #include "leaf_builder.h"
+#include "lindenmayer.h"
 #include "mesh.h"
 #include "NoiseGenerator.h"
 #include "PoissonGenerator.h"
@@ -33,6 +35,20 @@ struct TreeConfig {
     float angle;
     unsigned int resolution;
     std::string starting_production;
+    // Corteccia degli alberi cotti come tubi continui invece di cilindri e giunzioni
+    bool swept_branches = true;
+};
+
+// Limiti oltre i quali la generazione della foresta viene ridotta invece di bloccare l'applicazione
+struct GenerationBudget {
+    // Memoria per le trasformazioni dei moduli di tutta la foresta
+    float max_memory_mb = 512.0f;
+    // Simboli da riscrivere e interpretare, misura del tempo di generazione
+    float max_symbols = 2e8f;
+    // Livelli di derivazione tenuti in cache per cambiare il numero di iterazioni senza ripartire
+    float max_cache_mb = 256.0f;
+    // Geometria degli alberi cotti in un'unica mesh; gli alberi che non entrano restano a moduli istanziati
+    float max_baked_mb = 256.0f;
 };
 
 void error_callback(int error, const char* description);
@@ -61,13 +77,21 @@ unsigned int loadCubemap(const std::vector<std::string> &faces);
 Mesh setSkyBox();
 Mesh setWater();
 Mesh setWall();
+// Posizione e rotazione dei quattro muri attorno al terreno, come istanze della stessa mesh
+std::vector<ArenaInstance> wallInstances();
 Mesh setElevation(Biomes biome, Shader shader);
 
 std::vector<Point> generateTreePositions(Mesh terrain, Biomes biome, float minDist);
 
-std::vector<Tree> makeForest(std::vector<std::string> trees, const TreeConfig& config);
+// Base di ogni albero sul terreno: l'altezza viene calcolata una volta quando cambiano le posizioni
+std::vector<glm::vec3> treeOrigins(const Mesh& terrain, const std::vector<Point>& positions);
+
+// Le stime usano le regole già compilate del sistema L, che devono essere quelle di config
+GrowthEstimate estimateForest(const Lindenmayer& lsystem, const TreeConfig& config, size_t nTrees);
+
+int clampIterations(const Lindenmayer& lsystem, const TreeConfig& config, size_t nTrees, const GenerationBudget& budget);
 
-std::vector<std::string> treeStrings(const TreeConfig& config, int nTrees);
+std::vector<Tree> makeForest(const TreeConfig& config, Lindenmayer& lsystem, size_t nTrees, const GenerationBudget& budget = {});
 
 std::vector<Tree> adjustForest(const TreeConfig& config);
 
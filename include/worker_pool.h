@@ -0,0 +1,49 @@
+//
+// Created by Niccolo on 18/06/2025.
+//
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool di thread persistente: parallel_for distribuisce n task indipendenti e attende la fine.
+// Anche il thread chiamante partecipa al lavoro
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned int n_threads = std::thread::hardware_concurrency());
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    void parallel_for(size_t n_tasks, const std::function<void(size_t)> &task);
+
+    // Numero di thread che lavorano, chiamante incluso
+    [[nodiscard]] unsigned int size() const {
+        return static_cast<unsigned int>(workers.size()) + 1;
+    }
+
+    static WorkerPool &shared();
+private:
+    void worker_loop();
+    void run_tasks();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+
+    const std::function<void(size_t)> *current = nullptr;
+    size_t n_tasks = 0;
+    size_t next_task = 0;
+    size_t running = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+};
+
+#endif //WORKER_POOL_H
@@ -1,4 +1,5 @@
 #version 460 core
+#include "frame_data.glsl"
 
 
 out vec4 FragColor;
@@ -18,12 +19,10 @@ in vec3 fragPos;
 in vec3 normal;
 in vec2 texCoords;
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
 uniform Material material;
 
-uniform sampler2D texture_diffuse1;
-uniform sampler2D texture_specular1;
+layout(binding = 0) uniform sampler2D texture_diffuse1;
+layout(binding = 4) uniform sampler2D texture_specular1;
 
 
 
@@ -46,8 +45,9 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
 
 void main() {
     vec3 norm = normalize(normal);
-    vec3 viewDir = normalize(viewPos - fragPos);
+    vec3 viewDir = normalize(frame.viewPos.xyz - fragPos);
 
+    DirLight dirLight = DirLight(frame.lightDirection.xyz, frame.lightAmbient.rgb, frame.lightDiffuse.rgb, frame.lightSpecular.rgb);
     vec3 result = CalcDirLight(dirLight, norm, viewDir);
 
     FragColor = vec4(result, 1.0); // Red color
@@ -1,22 +1,26 @@
 #version 460
+#include "frame_data.glsl"
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Ogni muro è un'istanza: posizione, quaternione (xyzw) e scala
+layout (location = 3) in vec3 instancePosition;
+layout (location = 4) in vec4 instanceOrientation;
+layout (location = 5) in vec3 instanceScale;
 
 out vec2 texCoords;
 out vec3 fragPos;
 out vec3 normal;
 
+vec3 rotate(vec4 q, vec3 v) {
+    vec3 t = 2.0 * cross(q.xyz, v);
+    return v + q.w * t + cross(q.xyz, t);
+}
 
 void main() {
     texCoords = aTexCoords;
-    fragPos = vec3(model * vec4(aPos, 1.0));
-    normal = mat3(transpose(inverse(model))) * aNormal;
+    fragPos = rotate(instanceOrientation, instanceScale * aPos) + instancePosition;
+    normal = rotate(instanceOrientation, aNormal / instanceScale);
 
-    gl_Position = projection * view * vec4(fragPos, 1.0);
+    gl_Position = frame.viewProj * vec4(fragPos, 1.0);
 }
\ No newline at end of file
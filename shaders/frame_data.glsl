@@ -0,0 +1,17 @@
+// Dati per frame condivisi da tutti i programmi: li scrive FrameUniforms una volta per frame
+// (binding 0). Layout std140: solo mat4 e vec4, nello stesso ordine di FrameData in frame_uniforms.h
+layout(std140, binding = 0) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    // Vista senza traslazione, per lo skybox
+    mat4 skyViewProj;
+    vec4 viewPos;
+    // Luce direzionale: direzione, componenti ambiente, diffusa e speculare (xyz)
+    vec4 lightDirection;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    // x = secondi dall'avvio
+    vec4 time;
+} frame;
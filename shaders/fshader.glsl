@@ -1,4 +1,5 @@
 #version 460
+#include "frame_data.glsl"
 
 in vec2 tCoords;
 in vec3 fragPos;
@@ -7,26 +8,17 @@ in vec3 normal;
 out vec4 color;
 
 
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-};
-
-uniform vec3 vPos;
-uniform sampler2D diffuse;
+layout(binding = 0) uniform sampler2D diffuse;
 uniform float alpha_discard;
-uniform DirLight light;
 
 
 void main() {
     vec4 t_color = texture(diffuse, tCoords);
-    vec3 ambient = light.ambient * texture(diffuse, tCoords).rgb;
+    vec3 ambient = frame.lightAmbient.rgb * texture(diffuse, tCoords).rgb;
     vec3 norm = normalize(normal);
-    vec3 lightdir = normalize(-light.direction);
+    vec3 lightdir = normalize(-frame.lightDirection.xyz);
     float diff = max(dot(norm, lightdir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(diffuse, tCoords).rgb;
+    vec3 diffuse = frame.lightDiffuse.rgb * diff * texture(diffuse, tCoords).rgb;
 
     vec3 result = ambient + diffuse;
     if(t_color.a < alpha_discard){
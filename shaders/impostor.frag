@@ -0,0 +1,25 @@
+#version 460
+#include "frame_data.glsl"
+
+in vec3 tCoords;
+
+out vec4 color;
+
+
+layout(binding = 0) uniform sampler2DArray albedo;
+layout(binding = 6) uniform sampler2DArray normals;
+uniform float alpha_discard;
+
+
+void main() {
+    vec4 t_color = texture(albedo, tCoords);
+    if(t_color.a < alpha_discard){
+        discard;
+    }
+    // Stessa illuminazione di fshader.glsl con la normale salvata nell'atlante
+    vec3 norm = normalize(texture(normals, tCoords).rgb * 2.0 - 1.0);
+    vec3 lightdir = normalize(-frame.lightDirection.xyz);
+    float diff = max(dot(norm, lightdir), 0.0);
+    vec3 result = frame.lightAmbient.rgb * t_color.rgb + frame.lightDiffuse.rgb * diff * t_color.rgb;
+    color = vec4(result, 1.0);
+}
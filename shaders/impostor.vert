@@ -0,0 +1,39 @@
+#version 460
+#include "frame_data.glsl"
+
+// Quadrato [-1, 1]² e istanza dell'albero (base sul terreno e scala)
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 3) in vec3 instancePosition;
+layout(location = 4) in vec4 instanceOrientation;
+layout(location = 5) in vec3 instanceScale;
+
+// Centro (xyz) e raggio (w) di ogni variante in coordinate dell'albero, indicizzati da gl_DrawID
+layout(std430, binding = 0) readonly buffer ImpostorBounds {
+    vec4 bounds[];
+};
+
+out vec3 tCoords;
+
+uniform int views;
+uniform int layers;
+
+const float TWO_PI = 6.28318530718;
+
+void main() {
+    vec4 b = bounds[gl_DrawID];
+    vec3 center = instancePosition + instanceScale * b.xyz;
+    float radius = instanceScale.x * b.w;
+
+    // Billboard cilindrico: ruota solo attorno a Y verso la camera
+    vec3 toEye = frame.viewPos.xyz - center;
+    toEye.y = 0.0;
+    vec3 forward = dot(toEye, toEye) > 1e-8 ? normalize(toEye) : vec3(0.0, 0.0, 1.0);
+    vec3 right = vec3(forward.z, 0.0, -forward.x);
+    vec3 world = center + radius * (vertexPosition.x * right + vertexPosition.y * vec3(0.0, 1.0, 0.0));
+
+    // Vista dell'atlante più vicina alla direzione della camera, come in SceneRenderer::bakeImpostors
+    float view_index = mod(round(atan(forward.x, forward.z) / TWO_PI * float(views)), float(views));
+    tCoords = vec3((view_index + vertexPosition.x * 0.5 + 0.5) / float(views), vertexPosition.y * 0.5 + 0.5,
+                   float(gl_DrawID % layers));
+    gl_Position = frame.viewProj * vec4(world, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 460
+
+in vec2 tCoords;
+in vec3 fragPos;
+in vec3 normal;
+
+// Atlante degli impostor: colore (alfa = copertura) e normale in [0, 1]
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 normalOut;
+
+layout(binding = 0) uniform sampler2D diffuse;
+uniform float alpha_discard;
+
+
+void main() {
+    vec4 t_color = texture(diffuse, tCoords);
+    if(t_color.a < alpha_discard){
+        discard;
+    }
+    albedo = vec4(t_color.rgb, 1.0);
+    normalOut = vec4(normalize(normal) * 0.5 + 0.5, 1.0);
+}
@@ -1,4 +1,5 @@
 #version 460 core
+#include "frame_data.glsl"
 
 out vec4 FragColor;
 
@@ -17,14 +18,13 @@ in vec3 fragPos;
 in vec3 normal;
 in vec2 texCoords;
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
 
 
-uniform sampler2D texture_diffuse1;
-uniform sampler2D texture_diffuse2;
-uniform sampler2D texture_diffuse3;
-uniform sampler2D texture_diffuse4;
+// Unità fissate da TEXTURE_UNIT_BASE in material.h
+layout(binding = 0) uniform sampler2D texture_diffuse1;
+layout(binding = 1) uniform sampler2D texture_diffuse2;
+layout(binding = 2) uniform sampler2D texture_diffuse3;
+layout(binding = 3) uniform sampler2D texture_diffuse4;
 
 
 
@@ -132,10 +132,11 @@ vec3 getBiomeColor(float h, int biomeId) {
 
 void main() {
     vec3 norm = normalize(normal);
-    vec3 viewDir = normalize(viewPos - fragPos);
+    vec3 viewDir = normalize(frame.viewPos.xyz - fragPos);
 
     vec3 color = getBiomeColor(height, biomeId);
 
+    DirLight dirLight = DirLight(frame.lightDirection.xyz, frame.lightAmbient.rgb, frame.lightDiffuse.rgb, frame.lightSpecular.rgb);
     vec3 result = CalcDirLight(dirLight, norm, viewDir, color);
     FragColor = vec4(result, 1.0);
 }
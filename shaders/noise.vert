@@ -1,12 +1,10 @@
 #version 460 core
+#include "frame_data.glsl"
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform float maxAmplitude;
 
 out float height;
@@ -17,9 +15,10 @@ out vec3 normal;
 void main() {
     height = aPos.y / maxAmplitude;
     texCoords = aTexCoords;
-    fragPos = vec3(model * vec4(aPos, 1.0));
-    normal = mat3(transpose(inverse(model))) * aNormal;
+    // Il terreno è già in coordinate mondo
+    fragPos = aPos;
+    normal = aNormal;
 
-    gl_Position = projection * view * vec4(fragPos, 1.0);
+    gl_Position = frame.viewProj * vec4(fragPos, 1.0);
 }
 
@@ -1,14 +1,12 @@
 #version 460 core
+#include "frame_data.glsl"
 layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-
 void main()
 {
     TexCoords = aPos;
 
-    gl_Position = projection * view * vec4(aPos, 1.0);
+    gl_Position = frame.skyViewProj * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -1,20 +1,28 @@
 #version 460
+#include "frame_data.glsl"
 
 layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec3 normals;
 layout(location = 2) in vec2 texCoords;
+// Record compatto del modulo, per istanza: posizione, quaternione (xyzw) e scala per asse
+layout(location = 3) in vec3 instancePosition;
+layout(location = 4) in vec4 instanceOrientation;
+layout(location = 5) in vec3 instanceScale;
 
 out vec2 tCoords;
 out vec3 fragPos;
 out vec3 normal;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+vec3 rotate(vec4 q, vec3 v) {
+    vec3 t = 2.0 * cross(q.xyz, v);
+    return v + q.w * t + cross(q.xyz, t);
+}
 
 void main() {
     tCoords = texCoords;
-    fragPos = vec3(model * vec4(vertexPosition, 1.0));
-    normal = mat3(transpose(inverse(model))) * normals;
-    gl_Position = projection * view * vec4(fragPos, 1.0);
-}
\ No newline at end of file
+    // Le istanze sono già in coordinate mondo: orientamento e scala trasformano anche le normali,
+    // con la scala non uniforme invertita prima della rotazione
+    fragPos = rotate(instanceOrientation, instanceScale * vertexPosition) + instancePosition;
+    normal = rotate(instanceOrientation, normals / instanceScale);
+    gl_Position = frame.viewProj * vec4(fragPos, 1.0);
+}
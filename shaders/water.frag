@@ -1,9 +1,9 @@
-#version 330 core
+#version 460 core
+#include "frame_data.glsl"
 in vec2 texCoords;
 out vec4 FragColor;
 
-uniform float time;
-uniform sampler2D dudvMap;
+layout(binding = 6) uniform sampler2D dudvMap;
 
 uniform float waveFrequency;
 uniform float waveAmplitude;
@@ -22,18 +22,18 @@ void main() {
     vec2 dir = normalize(delta);
 
     // Genera distorsione radiale sinusoidale
-    float wave = sin(dist * waveFrequency + time * waveSpeed) * waveAmplitude;
+    float wave = sin(dist * waveFrequency + frame.time.x * waveSpeed) * waveAmplitude;
 
     // Applica distorsione nella direzione radiale usando seno/coseno
     vec2 distortion = -dir * wave;
 
     // Mescola con una dudv map per dettaglio fine
-    vec2 dudv = texture(dudvMap, texCoords + vec2(time * waveAmplitude)).rg * 0.02;
+    vec2 dudv = texture(dudvMap, texCoords + vec2(frame.time.x * waveAmplitude)).rg * 0.02;
 
     vec2 finalCoords = texCoords + distortion + dudv;
 
     // Colore base + leggera variazione
-    vec3 waterColor = vec3(0.0, 0.4, 0.6) + sin(dist * waveFrequency + time * waveSpeed) * 0.03;
+    vec3 waterColor = vec3(0.0, 0.4, 0.6) + sin(dist * waveFrequency + frame.time.x * waveSpeed) * 0.03;
 
     FragColor = vec4(waterColor, 0.5); // semitrasparente
 }
@@ -1,12 +1,10 @@
-#version 330 core
+#version 460 core
+#include "frame_data.glsl"
 layout(location = 0) in vec3 position;
 out vec2 texCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
-uniform float time;
 uniform float waveFrequency;
 uniform float waveAmplitude;
 uniform float waveSpeed;
@@ -18,11 +16,11 @@ void main() {
     float dist = distance(position.xz, vec2(10.0, 10.0));
 
     // Calcola la deformazione verticale basata su onde concentriche
-    float height = sin(dist * waveFrequency - time * waveSpeed) * waveAmplitude;
+    float height = sin(dist * waveFrequency - frame.time.x * waveSpeed) * waveAmplitude;
 
     // Applica la deformazione all'altezza (asse Y)
     vec3 displacedPosition = position + vec3(0.0, height, 0.0);
 
-    gl_Position = projection * view * model * vec4(displacedPosition, 1.0);
+    gl_Position = frame.viewProj * model * vec4(displacedPosition, 1.0);
 }
 
@@ -3,6 +3,8 @@
 //
 #include "NoiseGenerator.h"
 
+#include <ctime>
+
 // Costruttore
 NoiseGenerator::NoiseGenerator(): amplitude(0), sharpness(1.0f), frequency(0), warpAmp(0), warpFreq(0) {
 }
@@ -0,0 +1,153 @@
+//
+// Created by Niccolo on 28/06/2025.
+//
+
+#include "bounds.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BOUNDS_SSE 1
+#endif
+
+Bounds Bounds::inflated(float margin) const {
+    if (empty()) {
+        return *this;
+    }
+    return {min - margin, max + margin};
+}
+
+Bounds Bounds::transformed(const glm::vec3 &position, const glm::quat &orientation, const glm::vec3 &scale) const {
+    if (empty()) {
+        return *this;
+    }
+    // Il centro si trasforma come un punto, la semidimensione con il valore assoluto della rotazione
+    const glm::vec3 center = position + orientation * (scale * 0.5f * (min + max));
+    const glm::vec3 half = glm::abs(scale) * 0.5f * (max - min);
+    const glm::mat3 rotation = glm::mat3_cast(orientation);
+    glm::vec3 extent(0.0f);
+    for (int c = 0; c < 3; c++) {
+        extent += glm::abs(rotation[c]) * half[c];
+    }
+    return {center - extent, center + extent};
+}
+
+void SphereSet::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    r.clear();
+}
+
+void SphereSet::push(const glm::vec3 &center, float radius) {
+    x.push_back(center.x);
+    y.push_back(center.y);
+    z.push_back(center.z);
+    r.push_back(radius);
+}
+
+Frustum Frustum::from(const glm::mat4 &view_projection) {
+    const glm::mat4 &m = view_projection;
+    // glm è per colonne: la riga i è (m[0][i], m[1][i], m[2][i], m[3][i])
+    const auto row = [&](int i) {
+        return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    };
+    Frustum frustum;
+    frustum.planes = {
+        row(3) + row(0), row(3) - row(0),
+        row(3) + row(1), row(3) - row(1),
+        row(3) + row(2), row(3) - row(2)
+    };
+    for (glm::vec4 &plane : frustum.planes) {
+        const float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+    return frustum;
+}
+
+bool Frustum::intersects(const glm::vec3 &center, float radius) const {
+    for (const glm::vec4 &plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersects(const Bounds &box) const {
+    if (box.empty()) {
+        return false;
+    }
+    // Basta il vertice della scatola più avanti lungo la normale di ogni piano
+    for (const glm::vec4 &plane : planes) {
+        const glm::vec3 p(plane.x >= 0.0f ? box.max.x : box.min.x,
+                          plane.y >= 0.0f ? box.max.y : box.min.y,
+                          plane.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Containment Frustum::classify(const Bounds &box) const {
+    if (box.empty()) {
+        return Containment::Outside;
+    }
+    Containment result = Containment::Inside;
+    for (const glm::vec4 &plane : planes) {
+        const glm::vec3 normal(plane);
+        // Vertice più avanti (p) e più indietro (n) lungo la normale
+        const glm::vec3 p(plane.x >= 0.0f ? box.max.x : box.min.x,
+                          plane.y >= 0.0f ? box.max.y : box.min.y,
+                          plane.z >= 0.0f ? box.max.z : box.min.z);
+        const glm::vec3 n(plane.x >= 0.0f ? box.min.x : box.max.x,
+                          plane.y >= 0.0f ? box.min.y : box.max.y,
+                          plane.z >= 0.0f ? box.min.z : box.max.z);
+        if (glm::dot(normal, p) + plane.w < 0.0f) {
+            return Containment::Outside;
+        }
+        if (glm::dot(normal, n) + plane.w < 0.0f) {
+            result = Containment::Intersects;
+        }
+    }
+    return result;
+}
+
+void Frustum::cull(const SphereSet &spheres, std::vector<uint8_t> &visible) const {
+    const size_t n = spheres.size();
+    visible.resize(n);
+    size_t i = 0;
+#ifdef BOUNDS_SSE
+    // Quattro sfere per iterazione: ogni piano è replicato nei quattro canali
+    __m128 nx[6], ny[6], nz[6], nw[6];
+    for (size_t p = 0; p < planes.size(); p++) {
+        nx[p] = _mm_set1_ps(planes[p].x);
+        ny[p] = _mm_set1_ps(planes[p].y);
+        nz[p] = _mm_set1_ps(planes[p].z);
+        nw[p] = _mm_set1_ps(planes[p].w);
+    }
+    for (; i + 4 <= n; i += 4) {
+        const __m128 x = _mm_loadu_ps(spheres.x.data() + i);
+        const __m128 y = _mm_loadu_ps(spheres.y.data() + i);
+        const __m128 z = _mm_loadu_ps(spheres.z.data() + i);
+        const __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.r.data() + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t p = 0; p < planes.size(); p++) {
+            const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)),
+                                               _mm_add_ps(_mm_mul_ps(nz[p], z), nw[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, neg_r));
+        }
+        const int mask = _mm_movemask_ps(inside);
+        for (size_t k = 0; k < 4; k++) {
+            visible[i + k] = static_cast<uint8_t>((mask >> k) & 1);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        visible[i] = intersects(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.r[i]) ? 1 : 0;
+    }
+}
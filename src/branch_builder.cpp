@@ -82,7 +82,7 @@ void Branch::build_branch(float height, float R, float r) {
     }
 
     std::vector<Texture> textures;
-    textures.push_back(Texture{.id = this->tID, .type = ""});
+    textures.push_back(Texture{.id = this->tID, .kind = TextureKind::Diffuse});
 
     this->mesh = make_shared<Mesh>(vertices, indices, textures);
 }
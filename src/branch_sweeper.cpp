@@ -0,0 +1,212 @@
+//
+// Created by Niccolo on 27/06/2025.
+//
+
+#include "branch_sweeper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+#include <glm/ext/scalar_constants.hpp>
+
+namespace {
+    constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    // Cella della griglia usata per trovare gli inizi dei rami vicini a un punto
+    uint64_t cell_key(int64_t x, int64_t y, int64_t z) {
+        constexpr int64_t mask = (1 << 21) - 1;
+        return static_cast<uint64_t>(x & mask) | static_cast<uint64_t>(y & mask) << 21 | static_cast<uint64_t>(z & mask) << 42;
+    }
+}
+
+BranchSweeper::BranchSweeper(float length, float radius, unsigned int resolution)
+    : branch_length(length), branch_radius(radius), max_resolution(std::max(resolution, MIN_RESOLUTION)) {
+}
+
+unsigned int BranchSweeper::ring_resolution(float r) const {
+    if (r <= 0.0f) {
+        return MIN_RESOLUTION;
+    }
+    const double tolerance = 1.0 - std::cos(glm::pi<double>() / max_resolution);
+    const double c = 1.0 - tolerance * branch_radius / r;
+    if (c <= -1.0) {
+        return MIN_RESOLUTION;
+    }
+    const auto sides = static_cast<unsigned int>(std::ceil(glm::pi<double>() / std::acos(c) - 1e-6));
+    return std::clamp(sides, MIN_RESOLUTION, max_resolution);
+}
+
+size_t BranchSweeper::estimate(size_t branches) const {
+    // Catena di un solo segmento: due anelli con la cucitura più la punta chiusa
+    const size_t vertices = 3 * (max_resolution + 1) + 1;
+    const size_t indices = 9 * max_resolution;
+    return branches * (vertices * sizeof(Vertex) + indices * sizeof(unsigned int));
+}
+
+void BranchSweeper::sweep(const std::vector<ModuleInstance> &branches, std::vector<Vertex> &vertices,
+                          std::vector<unsigned int> &indices) const {
+    const size_t n = branches.size();
+    if (n == 0) {
+        return;
+    }
+
+    std::vector<glm::vec3> directions(n), ends(n);
+    for (size_t i = 0; i < n; i++) {
+        directions[i] = branches[i].orientation * glm::vec3(0.0f, 1.0f, 0.0f);
+        ends[i] = branches[i].position + directions[i] * (branch_length * branches[i].scale.y);
+    }
+
+    // Inizi dei rami in una griglia con celle grandi quanto la tolleranza
+    const float tolerance = LINK_TOLERANCE * branch_length;
+    const auto cell = [&](float v) {
+        return static_cast<int64_t>(std::floor(v / tolerance));
+    };
+    std::unordered_multimap<uint64_t, uint32_t> starts;
+    starts.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        const glm::vec3 &p = branches[i].position;
+        starts.emplace(cell_key(cell(p.x), cell(p.y), cell(p.z)), static_cast<uint32_t>(i));
+    }
+
+    // Ogni ramo prosegue nel ramo che parte dalla sua fine con la direzione più simile;
+    // gli altri rami che partono dallo stesso punto aprono nuove catene
+    std::vector<uint32_t> next(n, NONE);
+    std::vector<bool> linked(n, false);
+    for (size_t i = 0; i < n; i++) {
+        const glm::vec3 &e = ends[i];
+        const int64_t cx = cell(e.x), cy = cell(e.y), cz = cell(e.z);
+        uint32_t best = NONE;
+        float best_alignment = -2.0f;
+        for (int64_t dx = -1; dx <= 1; dx++) {
+            for (int64_t dy = -1; dy <= 1; dy++) {
+                for (int64_t dz = -1; dz <= 1; dz++) {
+                    const auto [first, last] = starts.equal_range(cell_key(cx + dx, cy + dy, cz + dz));
+                    for (auto it = first; it != last; ++it) {
+                        const uint32_t j = it->second;
+                        const glm::vec3 d = branches[j].position - e;
+                        if (j == i || linked[j] || glm::dot(d, d) > tolerance * tolerance) {
+                            continue;
+                        }
+                        const float alignment = glm::dot(directions[i], directions[j]);
+                        if (alignment > best_alignment) {
+                            best_alignment = alignment;
+                            best = j;
+                        }
+                    }
+                }
+            }
+        }
+        if (best != NONE) {
+            next[i] = best;
+            linked[best] = true;
+        }
+    }
+
+    // Le catene partono dai rami senza predecessore; i rami rimasti appartengono a cicli
+    // e vengono spezzati nel primo ramo non ancora usato
+    std::vector<bool> swept(n, false);
+    std::vector<uint32_t> chain;
+    const auto follow = [&](uint32_t i) {
+        chain.clear();
+        for (uint32_t c = i; c != NONE && !swept[c]; c = next[c]) {
+            swept[c] = true;
+            chain.push_back(c);
+        }
+        sweep_chain(branches, chain, directions, ends, vertices, indices);
+    };
+    for (uint32_t i = 0; i < n; i++) {
+        if (!linked[i]) {
+            follow(i);
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        if (!swept[i]) {
+            follow(i);
+        }
+    }
+}
+
+void BranchSweeper::sweep_chain(const std::vector<ModuleInstance> &branches, const std::vector<uint32_t> &chain,
+                                const std::vector<glm::vec3> &directions, const std::vector<glm::vec3> &ends,
+                                std::vector<Vertex> &vertices, std::vector<unsigned int> &indices) const {
+    const ModuleInstance &first = branches[chain.front()];
+    const unsigned int sides = ring_resolution(branch_radius * first.scale.x);
+    const auto ring_size = static_cast<unsigned int>(sides + 1);
+
+    // L'asse x dell'anello parte da quello del primo ramo e viene trasportato lungo la catena,
+    // così il tubo non si attorciglia quando la turtle ruota attorno al proprio asse
+    glm::vec3 axis_x = first.orientation * glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 tangent{};
+    glm::vec3 center{};
+    float r = 0.0f;
+
+    for (size_t k = 0; k <= chain.size(); k++) {
+        if (k == 0) {
+            center = first.position;
+            tangent = directions[chain.front()];
+            r = branch_radius * first.scale.x;
+        }
+        else if (k < chain.size()) {
+            // Anello condiviso sulla bisettrice tra i due segmenti
+            const uint32_t in = chain[k - 1], out = chain[k];
+            center = 0.5f * (ends[in] + branches[out].position);
+            const glm::vec3 bisector = directions[in] + directions[out];
+            tangent = glm::dot(bisector, bisector) > 1e-6f ? glm::normalize(bisector) : directions[out];
+            r = branch_radius * branches[in].scale.x;
+        }
+        else {
+            const uint32_t last = chain.back();
+            center = ends[last];
+            tangent = directions[last];
+            r = branch_radius * branches[last].scale.x;
+        }
+
+        axis_x -= glm::dot(axis_x, tangent) * tangent;
+        if (glm::dot(axis_x, axis_x) < 1e-8f) {
+            axis_x = std::abs(tangent.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+            axis_x -= glm::dot(axis_x, tangent) * tangent;
+        }
+        axis_x = glm::normalize(axis_x);
+        const glm::vec3 axis_z = glm::cross(axis_x, tangent);
+
+        // Anello con la cucitura duplicata per la coordinata u; v avanza di 1 per segmento come nel cilindro
+        const auto base = static_cast<unsigned int>(vertices.size());
+        for (unsigned int j = 0; j <= sides; j++) {
+            const float theta = 2.0f * glm::pi<float>() * static_cast<float>(j) / static_cast<float>(sides);
+            const glm::vec3 normal = std::cos(theta) * axis_x + std::sin(theta) * axis_z;
+            vertices.push_back(Vertex{
+                .position = center + r * normal,
+                .normal = normal,
+                .texCoords = glm::vec2(static_cast<float>(j) / static_cast<float>(sides), static_cast<float>(k))
+            });
+        }
+        if (k > 0) {
+            const unsigned int previous = base - ring_size;
+            for (unsigned int j = 0; j < sides; j++) {
+                indices.push_back(previous + j);
+                indices.push_back(base + j);
+                indices.push_back(previous + j + 1);
+
+                indices.push_back(base + j);
+                indices.push_back(base + j + 1);
+                indices.push_back(previous + j + 1);
+            }
+        }
+    }
+
+    // Punta chiusa: l'unica base visibile della catena
+    const auto tip = static_cast<unsigned int>(vertices.size());
+    vertices.push_back(Vertex{.position = center, .normal = tangent, .texCoords = glm::vec2(0.0f)});
+    for (unsigned int j = 0; j < sides; j++) {
+        const float theta = 2.0f * glm::pi<float>() * static_cast<float>(j) / static_cast<float>(sides);
+        const glm::vec3 offset = std::cos(theta) * axis_x + std::sin(theta) * glm::cross(axis_x, tangent);
+        vertices.push_back(Vertex{.position = center + r * offset, .normal = tangent, .texCoords = glm::vec2(0.0f)});
+    }
+    for (unsigned int j = 0; j < sides; j++) {
+        indices.push_back(tip);
+        indices.push_back(tip + 1 + (j + 1) % sides);
+        indices.push_back(tip + 1 + j);
+    }
+}
@@ -0,0 +1,32 @@
+//
+// Created by Niccolo on 30/06/2025.
+//
+
+#include "frame_uniforms.h"
+
+void FrameData::setCamera(const glm::mat4 &view_matrix, const glm::mat4 &projection_matrix, const glm::vec3 &eye) {
+    view = view_matrix;
+    projection = projection_matrix;
+    viewProj = projection * view;
+    skyViewProj = projection * glm::mat4(glm::mat3(view));
+    viewPos = glm::vec4(eye, 1.0f);
+}
+
+FrameUniforms::FrameUniforms() {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), &current, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+}
+
+FrameUniforms::~FrameUniforms() {
+    glDeleteBuffers(1, &buffer);
+}
+
+void FrameUniforms::update(const FrameData &data) {
+    current = data;
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &current);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,188 @@
+//
+// Created by Niccolo on 25/06/2025.
+//
+
+#include "geometry_arena.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <cstddef>
+
+GeometryArena::GeometryArena() {
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glGenBuffers(1, &instanceBuffer);
+
+    // Il formato dei vertici è quello di Mesh, le istanze hanno divisore 1
+    GLState::bindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, position)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, normal)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, texCoords)));
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glEnableVertexAttribArray(INSTANCE_LOCATION);
+    glVertexAttribPointer(INSTANCE_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(ArenaInstance), reinterpret_cast<void *>(offsetof(ArenaInstance, position)));
+    glVertexAttribDivisor(INSTANCE_LOCATION, 1);
+    glEnableVertexAttribArray(INSTANCE_LOCATION + 1);
+    glVertexAttribPointer(INSTANCE_LOCATION + 1, 4, GL_FLOAT, GL_FALSE, sizeof(ArenaInstance), reinterpret_cast<void *>(offsetof(ArenaInstance, orientation)));
+    glVertexAttribDivisor(INSTANCE_LOCATION + 1, 1);
+    glEnableVertexAttribArray(INSTANCE_LOCATION + 2);
+    glVertexAttribPointer(INSTANCE_LOCATION + 2, 3, GL_FLOAT, GL_FALSE, sizeof(ArenaInstance), reinterpret_cast<void *>(offsetof(ArenaInstance, scale)));
+    glVertexAttribDivisor(INSTANCE_LOCATION + 2, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    GLState::bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GeometryArena::~GeometryArena() {
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &VBO);
+    GLState::deleteVertexArray(VAO);
+}
+
+void GeometryArena::clear() {
+    vertices.clear();
+    indices.clear();
+    instances.clear();
+}
+
+ArenaRange GeometryArena::add(const Mesh &mesh) {
+    const ArenaRange range{static_cast<uint32_t>(indices.size()), 0, static_cast<int32_t>(vertices.size())};
+    vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    if (!mesh.indices.empty()) {
+        indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+    }
+    else {
+        // Le mesh senza indici vengono disegnate in ordine
+        for (unsigned int i = 0; i < mesh.vertices.size(); i++) {
+            indices.push_back(i);
+        }
+    }
+    return {range.first_index, static_cast<uint32_t>(indices.size()) - range.first_index, range.base_vertex};
+}
+
+ArenaRange GeometryArena::add(const std::vector<Vertex> &added_vertices, const std::vector<unsigned int> &added_indices) {
+    const ArenaRange range{static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(added_indices.size()), static_cast<int32_t>(vertices.size())};
+    vertices.insert(vertices.end(), added_vertices.begin(), added_vertices.end());
+    indices.insert(indices.end(), added_indices.begin(), added_indices.end());
+    return range;
+}
+
+uint32_t GeometryArena::add_instances(const std::vector<ArenaInstance> &added) {
+    const auto base = static_cast<uint32_t>(instances.size());
+    instances.insert(instances.end(), added.begin(), added.end());
+    return base;
+}
+
+void GeometryArena::upload() {
+    GLState::bindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(Vertex)), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    // Le istanze degli alberi cotti vengono riscritte a ogni frame con il livello di dettaglio
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instances.size() * sizeof(ArenaInstance)), instances.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned int)), indices.data(), GL_STATIC_DRAW);
+    GLState::bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::update_instances(uint32_t base, const ArenaInstance *updated, size_t count) {
+    if (count == 0 || base + count > instances.size()) {
+        return;
+    }
+    std::copy(updated, updated + count, instances.begin() + base);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(base * sizeof(ArenaInstance)),
+                    static_cast<GLsizeiptr>(count * sizeof(ArenaInstance)), updated);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::bind() const {
+    GLState::bindVertexArray(VAO);
+}
+
+void GeometryArena::draw(const ArenaRange &range, uint32_t base_instance) const {
+    if (range.index_count == 0) {
+        return;
+    }
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, static_cast<GLsizei>(range.index_count), GL_UNSIGNED_INT,
+                                                  reinterpret_cast<void *>(range.first_index * sizeof(unsigned int)),
+                                                  1, range.base_vertex, base_instance);
+}
+
+IndirectPass::IndirectPass() {
+    glGenBuffers(1, &buffer);
+}
+
+IndirectPass::~IndirectPass() {
+    glDeleteBuffers(1, &buffer);
+}
+
+void IndirectPass::clear() {
+    commands.clear();
+    dirty_first = SIZE_MAX;
+    dirty_last = 0;
+}
+
+size_t IndirectPass::add(const ArenaRange &range, uint32_t instance_count, uint32_t base_instance) {
+    if (instance_count == 0 || range.index_count == 0) {
+        return NONE;
+    }
+    commands.push_back({range.index_count, instance_count, range.first_index, range.base_vertex, base_instance});
+    return commands.size() - 1;
+}
+
+void IndirectPass::set_instances(size_t command, uint32_t instance_count, uint32_t base_instance) {
+    if (command == NONE) {
+        return;
+    }
+    DrawElementsIndirectCommand &c = commands[command];
+    if (c.instanceCount == instance_count && c.baseInstance == base_instance) {
+        return;
+    }
+    c.instanceCount = instance_count;
+    c.baseInstance = base_instance;
+    dirty_first = std::min(dirty_first, command);
+    dirty_last = std::max(dirty_last, command + 1);
+}
+
+void IndirectPass::upload() {
+    // Il culling e i livelli di dettaglio riscrivono i comandi a ogni frame con flush
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand)), commands.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    dirty_first = SIZE_MAX;
+    dirty_last = 0;
+}
+
+void IndirectPass::flush() {
+    if (dirty_first >= dirty_last) {
+        return;
+    }
+    constexpr size_t stride = sizeof(DrawElementsIndirectCommand);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLintptr>(dirty_first * stride),
+                    static_cast<GLsizeiptr>((dirty_last - dirty_first) * stride), commands.data() + dirty_first);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    dirty_first = SIZE_MAX;
+    dirty_last = 0;
+}
+
+void IndirectPass::draw(const GeometryArena &arena, const Material &material) const {
+    if (commands.empty()) {
+        return;
+    }
+    material.bind();
+    arena.bind();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
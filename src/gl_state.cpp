@@ -0,0 +1,179 @@
+//
+// Created by Niccolo on 02/07/2025.
+//
+
+#include "gl_state.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace {
+    constexpr GLuint UNKNOWN = std::numeric_limits<GLuint>::max();
+    // -1 sconosciuto, 0 spento, 1 acceso
+    constexpr int8_t UNKNOWN_FLAG = -1;
+
+    struct State {
+        GLuint program = UNKNOWN;
+        GLuint vao = UNKNOWN;
+        GLuint active_unit = UNKNOWN;
+        std::array<GLuint, GLState::TEXTURE_UNITS> textures{};
+        int8_t blend = UNKNOWN_FLAG;
+        int8_t cull = UNKNOWN_FLAG;
+        int8_t depth_test = UNKNOWN_FLAG;
+        int8_t depth_mask = UNKNOWN_FLAG;
+        GLenum blend_source = UNKNOWN;
+        GLenum blend_destination = UNKNOWN;
+
+        State() {
+            textures.fill(UNKNOWN);
+        }
+    };
+
+    State state;
+    GLState::Stats current, previous;
+
+    int8_t *flag(GLenum capability) {
+        switch (capability) {
+            case GL_BLEND:
+                return &state.blend;
+            case GL_CULL_FACE:
+                return &state.cull;
+            case GL_DEPTH_TEST:
+                return &state.depth_test;
+            default:
+                return nullptr;
+        }
+    }
+
+    // true se la chiamata va fatta; aggiorna i contatori
+    bool changes(bool differs) {
+        if (differs) {
+            current.issued++;
+        } else {
+            current.skipped++;
+        }
+        return differs;
+    }
+}
+
+void GLState::useProgram(GLuint program) {
+    if (changes(state.program != program)) {
+        glUseProgram(program);
+        state.program = program;
+    }
+}
+
+void GLState::bindVertexArray(GLuint vao) {
+    if (changes(state.vao != vao)) {
+        glBindVertexArray(vao);
+        state.vao = vao;
+    }
+}
+
+void GLState::bindTextures(GLuint first, GLsizei count, const GLuint *textures) {
+    // Solo le unità che cambiano, in un'unica chiamata dalla prima all'ultima
+    GLsizei lo = count, hi = -1;
+    for (GLsizei i = 0; i < count; i++) {
+        const GLuint unit = first + static_cast<GLuint>(i);
+        if (unit >= TEXTURE_UNITS || state.textures[unit] != textures[i]) {
+            lo = std::min(lo, i);
+            hi = i;
+        }
+    }
+    if (!changes(hi >= lo)) {
+        return;
+    }
+    glBindTextures(first + static_cast<GLuint>(lo), hi - lo + 1, textures + lo);
+    for (GLsizei i = lo; i <= hi; i++) {
+        if (const GLuint unit = first + static_cast<GLuint>(i); unit < TEXTURE_UNITS) {
+            state.textures[unit] = textures[i];
+        }
+    }
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture) {
+    if (changes(state.active_unit != 0)) {
+        glActiveTexture(GL_TEXTURE0);
+        state.active_unit = 0;
+    }
+    if (changes(state.textures[0] != texture)) {
+        glBindTexture(target, texture);
+        state.textures[0] = texture;
+    }
+}
+
+void GLState::setEnabled(GLenum capability, bool enabled) {
+    int8_t *cached = flag(capability);
+    if (cached == nullptr) {
+        enabled ? glEnable(capability) : glDisable(capability);
+        current.issued++;
+        return;
+    }
+    if (changes(*cached != static_cast<int8_t>(enabled))) {
+        enabled ? glEnable(capability) : glDisable(capability);
+        *cached = static_cast<int8_t>(enabled);
+    }
+}
+
+bool GLState::isEnabled(GLenum capability) {
+    int8_t *cached = flag(capability);
+    if (cached == nullptr) {
+        return glIsEnabled(capability) == GL_TRUE;
+    }
+    if (*cached == UNKNOWN_FLAG) {
+        *cached = static_cast<int8_t>(glIsEnabled(capability) == GL_TRUE);
+    }
+    return *cached == 1;
+}
+
+void GLState::depthMask(bool write) {
+    if (changes(state.depth_mask != static_cast<int8_t>(write))) {
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+        state.depth_mask = static_cast<int8_t>(write);
+    }
+}
+
+void GLState::blendFunc(GLenum source, GLenum destination) {
+    if (changes(state.blend_source != source || state.blend_destination != destination)) {
+        glBlendFunc(source, destination);
+        state.blend_source = source;
+        state.blend_destination = destination;
+    }
+}
+
+void GLState::deleteProgram(GLuint program) {
+    glDeleteProgram(program);
+    // Un programma in uso resta valido fino al prossimo cambio, ma il nome può tornare
+    if (state.program == program) {
+        state.program = UNKNOWN;
+    }
+}
+
+void GLState::deleteVertexArray(GLuint vao) {
+    glDeleteVertexArrays(1, &vao);
+    if (state.vao == vao) {
+        state.vao = 0;
+    }
+}
+
+void GLState::deleteTextures(GLsizei count, const GLuint *textures) {
+    glDeleteTextures(count, textures);
+    // Le unità che le contenevano perdono quel target: meglio non sapere cosa resta
+    for (GLsizei i = 0; i < count; i++) {
+        for (GLuint &bound : state.textures) {
+            if (bound == textures[i]) {
+                bound = UNKNOWN;
+            }
+        }
+    }
+}
+
+void GLState::endFrame() {
+    previous = current;
+    current = Stats();
+}
+
+const GLState::Stats &GLState::lastFrame() {
+    return previous;
+}
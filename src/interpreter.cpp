@@ -3,183 +3,359 @@
 //
 
 #include "interpreter.h"
+#include "token_stream.h"
 
-#include <utility>
+#include <algorithm>
+#include <cmath>
 
-Interpreter::Interpreter(float angle, glm::vec3 position, float radius, float length, float radius_decay, float length_decay) : init_radius(radius), init_length(length), radius_decay(radius_decay), length_decay(length_decay) {
-
-    TurtleState s = TurtleState();
-    s.position = position;
-    s.orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
-    s.forward = glm::vec3(0.0f, 1.0f, 0.0f);
-    s.up = glm::vec3(0.0f, 0.0f,1.0f);
-    s.right = glm::vec3(1.0f, 0.0f, 0.0f);
-    s.step = this->init_length;
-    s.scale_matrix = glm::mat4(1.0f);
+Interpreter::Interpreter(float angle, float radius, float length, float radius_decay, float length_decay) : init_radius(radius), init_length(length), radius_decay(radius_decay), length_decay(length_decay) {
     this->angle = glm::radians(angle);
-    this->state = s;
-}
-
-void Interpreter::read_string(const std::string &predicate, std::vector<char>& models, std::vector<glm::mat4>& transforms) {
-    TurtleState current = this->state;
-    glm::quat rot;
-    glm::mat4 translation, rotation = glm::mat4(1.0f);
-    for (char c : predicate) {
-        switch (c) {
-            case 'J': {
-                translation = glm::translate(glm::mat4(1.0f), current.position);
-                rotation = glm::mat4_cast(current.orientation);
-                transforms.push_back(translation * rotation * glm::scale(current.scale_matrix, glm::vec3(1.0f, current.scale_matrix[0][0], 1.0f)));
-                models.push_back('J');
-                break;
-            }
-            case 'F': {
-                translation = glm::translate(glm::mat4(1.0f), current.position);
-                rotation = glm::mat4_cast(current.orientation);
-                transforms.push_back(translation * rotation * current.scale_matrix);
-                glm::vec3 movement_direction = glm::normalize(glm::vec3(current.forward.x, current.forward.y, current.forward.z));
-                this->state.position = current.position + current.step * movement_direction;
-                current = this->state;
-                models.push_back('F');
-                break;
-            }
-            case 'L': {
-                translation = glm::translate(glm::mat4(1.0f), current.position);
-                rotation = glm::mat4_cast(current.orientation);
-                transforms.push_back(translation * rotation * scale(glm::mat4(1.0), glm::vec3(current.scale_matrix[1][1])));
-                models.push_back('L');
-                break;
-            }
-            case '+': {
-                // Esegui la rotazione e salvala
-                rot = glm::angleAxis(this->angle, current.up);
-                this->state.orientation = rot * current.orientation;
-                // Ruota il sistema di riferimento locale
-                glm::quat up = glm::quat(0.0f, current.up);
-                glm::quat right = glm::quat(0.0f, current.right);
-                glm::quat forward = glm::quat(0.0f, current.forward);
-                glm::quat rotated_fwd = rot * forward * glm::conjugate(rot);
-                glm::quat rotated_up = rot * up * glm::conjugate(rot);
-                glm::quat rotated_right = rot * right * glm::conjugate(rot);
-                this->state.up = glm::normalize(glm::vec3(rotated_up.x, rotated_up.y, rotated_up.z));
-                this->state.forward = glm::normalize(glm::vec3(rotated_fwd.x, rotated_fwd.y, rotated_fwd.z));
-                this->state.right = glm::normalize(glm::vec3(rotated_right.x, rotated_right.y, rotated_right.z));
-                current = this->state;
-                break;
-            }
-            case '-': {
-                rot = glm::angleAxis(-this->angle, current.up);
-                this->state.orientation = rot * current.orientation;
-                // Ruota il sistema di riferimento locale
-                glm::quat up = glm::quat(0.0f, current.up);
-                glm::quat right = glm::quat(0.0f, current.right);
-                glm::quat forward = glm::quat(0.0f, current.forward);
-                glm::quat rotated_fwd = rot * forward * glm::conjugate(rot);
-                glm::quat rotated_up = rot * up * glm::conjugate(rot);
-                glm::quat rotated_right = rot * right * glm::conjugate(rot);
-                this->state.up = glm::normalize(glm::vec3(rotated_up.x, rotated_up.y, rotated_up.z));
-                this->state.forward = glm::normalize(glm::vec3(rotated_fwd.x, rotated_fwd.y, rotated_fwd.z));
-                this->state.right = glm::normalize(glm::vec3(rotated_right.x, rotated_right.y, rotated_right.z));
-                current = this->state;
-                break;
-            }
-            case '&': {
-                rot = glm::angleAxis(this->angle, current.right);
-                this->state.orientation = rot * current.orientation;
-                glm::quat up = glm::quat(0.0f, current.up);
-                glm::quat right = glm::quat(0.0f, current.right);
-                glm::quat forward = glm::quat(0.0f, current.forward);
-                glm::quat rotated_fwd = rot * forward * glm::conjugate(rot);
-                glm::quat rotated_up = rot * up * glm::conjugate(rot);
-                glm::quat rotated_right = rot * right * glm::conjugate(rot);
-                this->state.up = glm::normalize(glm::vec3(rotated_up.x, rotated_up.y, rotated_up.z));
-                this->state.forward = glm::normalize(glm::vec3(rotated_fwd.x, rotated_fwd.y, rotated_fwd.z));
-                this->state.right = glm::normalize(glm::vec3(rotated_right.x, rotated_right.y, rotated_right.z));
-                current = this->state;
-                break;
+    const std::array<glm::vec3, ROTATIONS> axes = {
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+    };
+    for (unsigned int a = 0; a < ROTATIONS; a++) {
+        for (unsigned int k = 1; k <= MAX_TOKEN_RUN; k++) {
+            rotations[a][k - 1] = glm::angleAxis(this->angle * static_cast<float>(k), axes[a]);
+        }
+    }
+}
+
+TurtleState Interpreter::initial_state(glm::vec3 position) const {
+    return {position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), init_length, 1.0f, 1.0f};
+}
+
+void Interpreter::read_string(const std::string &predicate, TurtleScratch &scratch, TreeModules &modules, glm::vec3 position, WorkerPool *pool) const {
+    TurtleOptimizer optimizer(*this, scratch);
+    char op;
+    unsigned int count;
+    for (size_t i = 0; i < predicate.size();) {
+        i += read_token(predicate.data() + i, op, count);
+        optimizer.feed(op, count);
+    }
+    run(optimizer.finish(), scratch, modules, position, pool);
+}
+
+ModuleCounts Interpreter::count_modules(const std::vector<TurtleOp> &ops) {
+    ModuleCounts modules{};
+    for (const TurtleOp &op : ops) {
+        if (is_module(op.kind)) {
+            modules[static_cast<size_t>(op.kind)] += op.count;
+        }
+    }
+    return modules;
+}
+
+void Interpreter::run(const std::vector<TurtleOp> &ops, TurtleScratch &scratch, TreeModules &modules, glm::vec3 position, WorkerPool *pool) const {
+    // L'uscita viene dimensionata una volta: ogni modulo ha già il suo posto
+    const ModuleCounts counts = count_modules(ops);
+    std::array<ModuleInstance *, MODULE_KINDS> out{};
+    size_t total = 0;
+    for (size_t k = 0; k < MODULE_KINDS; k++) {
+        const size_t base = modules.kinds[k].size();
+        modules.kinds[k].resize(base + counts[k]);
+        out[k] = modules.kinds[k].data() + base;
+        total += counts[k];
+    }
+    const TurtleState start = initial_state(position);
+    if (pool != nullptr && pool->size() > 1 && total >= PARALLEL_MODULES) {
+        modules.bounds.expand(run_parallel(ops, scratch, out, start, total, *pool));
+        return;
+    }
+    Turtle turtle(*this, scratch.stack, out, start);
+    turtle.run(ops.data(), ops.data() + ops.size());
+    modules.bounds.expand(turtle.bounds());
+}
+
+Bounds Interpreter::run_parallel(const std::vector<TurtleOp> &ops, TurtleScratch &scratch, const std::array<ModuleInstance *, MODULE_KINDS> &out, const TurtleState &start, size_t total, WorkerPool &pool) const {
+    constexpr uint32_t NO_MATCH = UINT32_MAX;
+    const size_t n = ops.size();
+
+    // Scansione delle parentesi: Pop corrispondente a ogni Push e moduli di ogni tipo prodotti prima di ogni operazione
+    scratch.match.assign(n, NO_MATCH);
+    scratch.modules_before.resize(n + 1);
+    scratch.branches.clear();
+    ModuleCounts modules{};
+    for (size_t i = 0; i < n; i++) {
+        scratch.modules_before[i] = modules;
+        const TurtleOp &op = ops[i];
+        if (is_module(op.kind)) {
+            modules[static_cast<size_t>(op.kind)] += op.count;
+        }
+        else if (op.kind == TurtleOpKind::Push && op.count == 1) {
+            scratch.branches.emplace_back(i, false);
+        }
+        else if (op.kind == TurtleOpKind::Pop && op.count == 1 && !scratch.branches.empty()) {
+            scratch.match[scratch.branches.back().first] = static_cast<uint32_t>(i);
+            scratch.branches.pop_back();
+        }
+    }
+    scratch.modules_before[n] = modules;
+
+    // Passata seriale sul tronco: un ramo abbastanza piccolo diventa un task con lo stato d'ingresso
+    // e il suo intervallo di uscita, uno più grande viene percorso per cercare i sottorami.
+    // Saltare un ramo intero non cambia lo stato, perché Pop ripristina quello della Push
+    const size_t grain = std::max<size_t>(MIN_TASK_MODULES, total / (pool.size() * 8));
+    scratch.tasks.clear();
+    Turtle trunk(*this, scratch.stack, out, start);
+    for (size_t i = 0; i < n; i++) {
+        if (ops[i].kind == TurtleOpKind::Push && scratch.match[i] != NO_MATCH) {
+            const uint32_t pop = scratch.match[i];
+            ModuleCounts block{};
+            uint64_t block_total = 0;
+            for (size_t k = 0; k < MODULE_KINDS; k++) {
+                block[k] = scratch.modules_before[pop][k] - scratch.modules_before[i][k];
+                block_total += block[k];
             }
-            case '^': {
-                rot = glm::angleAxis(-this->angle, current.right);
-                this->state.orientation = rot * current.orientation;
-                glm::quat up = glm::quat(0.0f, current.up);
-                glm::quat right = glm::quat(0.0f, current.right);
-                glm::quat forward = glm::quat(0.0f, current.forward);
-                glm::quat rotated_fwd = rot * forward * glm::conjugate(rot);
-                glm::quat rotated_up = rot * up * glm::conjugate(rot);
-                glm::quat rotated_right = rot * right * glm::conjugate(rot);
-                this->state.up = glm::normalize(glm::vec3(rotated_up.x, rotated_up.y, rotated_up.z));
-                this->state.forward = glm::normalize(glm::vec3(rotated_fwd.x, rotated_fwd.y, rotated_fwd.z));
-                this->state.right = glm::normalize(glm::vec3(rotated_right.x, rotated_right.y, rotated_right.z));
-                current = this->state;
-                break;
+            if (block_total <= grain) {
+                if (block_total > 0) {
+                    scratch.tasks.push_back({trunk.current(), static_cast<uint32_t>(i), pop, scratch.modules_before[i]});
+                    trunk.skip(block);
+                }
+                i = pop;
+                continue;
             }
-            case '/': {
-                rot = glm::angleAxis(this->angle, current.forward);
-                this->state.orientation = rot * current.orientation;
-                glm::quat up = glm::quat(0.0f, current.up);
-                glm::quat right = glm::quat(0.0f, current.right);
-                glm::quat forward = glm::quat(0.0f, current.forward);
-                glm::quat rotated_fwd = rot * forward * glm::conjugate(rot);
-                glm::quat rotated_up = rot * up * glm::conjugate(rot);
-                glm::quat rotated_right = rot * right * glm::conjugate(rot);
-                this->state.up = glm::normalize(glm::vec3(rotated_up.x, rotated_up.y, rotated_up.z));
-                this->state.forward = glm::normalize(glm::vec3(rotated_fwd.x, rotated_fwd.y, rotated_fwd.z));
-                this->state.right = glm::normalize(glm::vec3(rotated_right.x, rotated_right.y, rotated_right.z));
-                current = this->state;
-                break;
+        }
+        trunk.run(ops[i]);
+    }
+
+    // I task contigui vengono raggruppati, ogni gruppo ha il suo stack
+    const size_t n_tasks = scratch.tasks.size();
+    const size_t groups = std::min<size_t>(n_tasks, pool.size() * 4);
+    if (scratch.task_stacks.size() < groups) {
+        scratch.task_stacks.resize(groups);
+    }
+    // Una scatola per gruppo, unite alla fine a quella del tronco
+    std::vector<Bounds> &group_bounds = scratch.group_bounds;
+    group_bounds.assign(groups, Bounds{});
+    pool.parallel_for(groups, [&](size_t g) {
+        for (size_t t = g * n_tasks / groups; t < (g + 1) * n_tasks / groups; t++) {
+            const TurtleTask &task = scratch.tasks[t];
+            std::array<ModuleInstance *, MODULE_KINDS> task_out{};
+            for (size_t k = 0; k < MODULE_KINDS; k++) {
+                task_out[k] = out[k] + task.out[k];
             }
-            case '(': {
-                rot = glm::angleAxis(-this->angle, current.forward);
-                this->state.orientation = rot * current.orientation;
-                glm::quat up = glm::quat(0.0f, current.up);
-                glm::quat right = glm::quat(0.0f, current.right);
-                glm::quat forward = glm::quat(0.0f, current.forward);
-                glm::quat rotated_fwd = rot * forward * glm::conjugate(rot);
-                glm::quat rotated_up = rot * up * glm::conjugate(rot);
-                glm::quat rotated_right = rot * right * glm::conjugate(rot);
-                this->state.up = glm::normalize(glm::vec3(rotated_up.x, rotated_up.y, rotated_up.z));
-                this->state.forward = glm::normalize(glm::vec3(rotated_fwd.x, rotated_fwd.y, rotated_fwd.z));
-                this->state.right = glm::normalize(glm::vec3(rotated_right.x, rotated_right.y, rotated_right.z));
-                current = this->state;
-                break;
+            Turtle turtle(*this, scratch.task_stacks[g], task_out, task.entry);
+            turtle.run(ops.data() + task.push + 1, ops.data() + task.pop);
+            group_bounds[g].expand(turtle.bounds());
+        }
+    });
+
+    Bounds bounds = trunk.bounds();
+    for (const Bounds &b : group_bounds) {
+        bounds.expand(b);
+    }
+    return bounds;
+}
+
+TurtleOptimizer::TurtleOptimizer(const Interpreter &interpreter, TurtleScratch &scratch)
+    : interpreter(interpreter), scratch(scratch), pending_rotation(1.0f, 0.0f, 0.0f, 0.0f) {
+    scratch.ops.clear();
+    scratch.branches.clear();
+}
+
+void TurtleOptimizer::flush() {
+    // Rotazione e scala commutano: accumulate fino al prossimo modulo o '[' escono come al più due
+    // operazioni, unite a quelle già in coda (es. dopo un ramo eliminato)
+    int32_t rotate = -1, scale = -1;
+    for (size_t i = scratch.ops.size(); i > 0 && scratch.ops.size() - i < 2; i--) {
+        const TurtleOpKind kind = scratch.ops[i - 1].kind;
+        if (kind == TurtleOpKind::Rotate && rotate < 0) {
+            rotate = static_cast<int32_t>(i - 1);
+        }
+        else if (kind == TurtleOpKind::Scale && scale < 0) {
+            scale = static_cast<int32_t>(i - 1);
+        }
+        else {
+            break;
+        }
+    }
+    const bool cancels = pending_axis == NO_AXIS || (pending_axis != MIXED_AXES && pending_turns == 0);
+    if (!cancels) {
+        const glm::quat q = glm::normalize(pending_rotation);
+        if (rotate >= 0) {
+            scratch.ops[rotate].rotation = glm::normalize(scratch.ops[rotate].rotation * q);
+        }
+        else {
+            scratch.ops.push_back({TurtleOpKind::Rotate, 1, q, 1.0f});
+        }
+    }
+    if (pending_radius != 1.0f || pending_length > 0) {
+        if (scale >= 0) {
+            scratch.ops[scale].radius_scale *= pending_radius;
+            scratch.ops[scale].count += pending_length;
+        }
+        else {
+            scratch.ops.push_back({TurtleOpKind::Scale, pending_length, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), pending_radius});
+        }
+    }
+    clear_pending();
+}
+
+void TurtleOptimizer::clear_pending() {
+    pending_rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    pending_axis = NO_AXIS;
+    pending_turns = 0;
+    pending_radius = 1.0f;
+    pending_length = 0;
+}
+
+void TurtleOptimizer::module(TurtleOpKind kind, unsigned int count) {
+    flush();
+    if (!scratch.branches.empty()) {
+        scratch.branches.back().second = true;
+    }
+    // Moduli uguali consecutivi diventano un'unica operazione
+    if (!scratch.ops.empty() && scratch.ops.back().kind == kind) {
+        scratch.ops.back().count += count;
+        return;
+    }
+    scratch.ops.push_back({kind, count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 1.0f});
+}
+
+void TurtleOptimizer::feed(char c, unsigned int count) {
+    switch (c) {
+        // 'X' viene trattato come 'F': non serve più la pulizia della stringa
+        case 'X':
+        case 'F': module(TurtleOpKind::Branch, count); break;
+        case 'L': module(TurtleOpKind::Leaf, count); break;
+        case 'J': module(TurtleOpKind::Junction, count); break;
+        case '+':
+        case '-':
+        case '&':
+        case '^':
+        case '/':
+        case '(': {
+            const unsigned int axis = c == '+' ? 0 : c == '-' ? 1 : c == '&' ? 2 : c == '^' ? 3 : c == '/' ? 4 : 5;
+            const auto pair = static_cast<int8_t>(axis / 2);
+            pending_axis = pending_axis == NO_AXIS || pending_axis == pair ? pair : MIXED_AXES;
+            pending_turns += axis % 2 == 0 ? static_cast<int64_t>(count) : -static_cast<int64_t>(count);
+            while (count > 0) {
+                const unsigned int k = std::min(count, MAX_TOKEN_RUN);
+                pending_rotation = pending_rotation * interpreter.rotations[axis][k - 1];
+                count -= k;
             }
-            case '!': {
-                this->state.scale_matrix = scale(this->state.scale_matrix, glm::vec3(radius_decay, 1.0f, radius_decay ));
-                this->state.radius *= radius_decay;
-                current = this->state;
-                break;
+            break;
+        }
+        case '!': {
+            pending_radius *= std::pow(interpreter.radius_decay, static_cast<float>(count));
+            break;
+        }
+        case '%': {
+            pending_length += count;
+            break;
+        }
+        case '[': {
+            flush();
+            for (unsigned int i = 0; i < count; i++) {
+                scratch.branches.emplace_back(scratch.ops.size(), false);
+                scratch.ops.push_back({TurtleOpKind::Push, 1, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 1.0f});
             }
-            case '%': {
-                if (this->state.step * length_decay > init_length/5) {
-                    this->state.scale_matrix = scale(this->state.scale_matrix, glm::vec3(1.0f, length_decay, 1.0f ));
-                    this->state.step *= length_decay;
+            break;
+        }
+        case ']': {
+            // Tutto quello che resta in sospeso verrebbe annullato dal ripristino dello stato
+            clear_pending();
+            for (unsigned int i = 0; i < count && !scratch.branches.empty(); i++) {
+                const auto [push, geometry] = scratch.branches.back();
+                scratch.branches.pop_back();
+                if (!geometry) {
+                    // Ramo senza geometria: si torna all'indice salvato alla sua '['
+                    scratch.ops.resize(push);
+                    continue;
+                }
+                if (!scratch.branches.empty()) {
+                    scratch.branches.back().second = true;
                 }
-                current = this->state;
-                break;
+                scratch.ops.push_back({TurtleOpKind::Pop, 1, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 1.0f});
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+const std::vector<TurtleOp> &TurtleOptimizer::finish() {
+    // Le operazioni rimaste in sospeso alla fine non hanno effetto su nessun modulo
+    clear_pending();
+    return scratch.ops;
+}
+
+Turtle::Turtle(const Interpreter &interpreter, std::vector<TurtleState> &stack, const std::array<ModuleInstance *, MODULE_KINDS> &out, const TurtleState &start)
+    : interpreter(interpreter), stack(stack), out(out), state(start) {
+    stack.clear();
+}
+
+void Turtle::skip(const ModuleCounts &n) {
+    for (size_t k = 0; k < MODULE_KINDS; k++) {
+        out[k] += n[k];
+    }
+}
+
+void Turtle::emit(TurtleOpKind kind, const glm::vec3 &scale, unsigned int count) {
+    // La matrice del modulo viene ricostruita nel vertex shader: qui basta il record compatto.
+    // Si rinormalizza l'orientamento per non accumulare errore
+    state.orientation = glm::normalize(state.orientation);
+    if (count > 0) {
+        // Rami e giunzioni sporgono di un raggio dal loro asse
+        box.expand(state.position, kind == TurtleOpKind::Leaf ? 0.0f : interpreter.init_radius * scale.x);
+    }
+    ModuleInstance *&o = out[static_cast<size_t>(kind)];
+    o = std::fill_n(o, count, ModuleInstance{state.position, state.orientation, scale});
+}
+
+void Turtle::run(const TurtleOp *begin, const TurtleOp *end) {
+    for (const TurtleOp *op = begin; op != end; op++) {
+        run(*op);
+    }
+}
+
+void Turtle::run(const TurtleOp &op) {
+    const float r = state.radius_scale;
+    const float l = state.length_scale;
+    switch (op.kind) {
+        case TurtleOpKind::Junction: {
+            emit(TurtleOpKind::Junction, glm::vec3(r, l * r, r), op.count);
+            break;
+        }
+        case TurtleOpKind::Branch: {
+            for (uint32_t i = 0; i < op.count; i++) {
+                emit(TurtleOpKind::Branch, glm::vec3(r, l, r), 1);
+                state.position += state.step * (state.orientation * glm::vec3(0.0f, 1.0f, 0.0f));
+                box.expand(state.position, interpreter.init_radius * r);
             }
-            case '[': {
-                this->state_stack.push(current);
-                break;
+            break;
+        }
+        case TurtleOpKind::Leaf: {
+            emit(TurtleOpKind::Leaf, glm::vec3(l), op.count);
+            break;
+        }
+        case TurtleOpKind::Rotate: {
+            // Ruotare attorno a un asse della terna locale equivale a moltiplicare a destra
+            state.orientation = state.orientation * op.rotation;
+            break;
+        }
+        case TurtleOpKind::Scale: {
+            state.radius_scale *= op.radius_scale;
+            // La soglia sul passo minimo va controllata a ogni applicazione di '%'
+            for (uint32_t i = 0; i < op.count && state.step * interpreter.length_decay > interpreter.init_length/5; i++) {
+                state.length_scale *= interpreter.length_decay;
+                state.step *= interpreter.length_decay;
             }
-            case ']': {
-                this->state = this->state_stack.top();
-                current = this->state;
-                this->state_stack.pop();
-                break;
+            break;
+        }
+        case TurtleOpKind::Push: {
+            stack.insert(stack.end(), op.count, state);
+            break;
+        }
+        case TurtleOpKind::Pop: {
+            for (uint32_t i = 0; i < op.count && !stack.empty(); i++) {
+                state = stack.back();
+                stack.pop_back();
             }
-            default:
-                break;
+            break;
         }
     }
 }
-
-void Interpreter::reset_interpreter(glm::vec3 position) {
-    this->state.position = position;
-    this->state.orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
-    this->state.forward = glm::vec3(0.0f, 1.0f, 0.0f);
-    this->state.up = glm::vec3(0.0f, 0.0f,1.0f);
-    this->state.right = glm::vec3(1.0f, 0.0f, 0.0f);
-    this->state.scale_matrix = glm::mat4(1.0f);
-    this->state.step = init_length;
-    this->state.radius = init_radius;
-}
\ No newline at end of file
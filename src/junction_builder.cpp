@@ -54,7 +54,7 @@ void Junction::build_junciton(float radius) {
     }
 
     std::vector<Texture> textures;
-    textures.push_back(Texture{.id = this->tID, .type = ""});
+    textures.push_back(Texture{.id = this->tID, .kind = TextureKind::Diffuse});
 
     this->mesh = make_shared<Mesh>(vertices, indices, textures);
 }
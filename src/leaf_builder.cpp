@@ -33,7 +33,7 @@ void Leaf::build_leaf(float size) {
         indices = {0, 2, 1, 2, 3, 1, 5, 7, 4, 7, 6, 4};
 
         std::vector<Texture> textures;
-        textures.push_back(Texture{.id = this->tID, .type = ""});
+        textures.push_back(Texture{.id = this->tID, .kind = TextureKind::Diffuse});
 
         this->mesh = std::make_shared<Mesh>(vertices, indices, textures);
     }
@@ -111,7 +111,7 @@ void Leaf::build_leaf(float size) {
         }
 
         std::vector<Texture> textures;
-        textures.push_back(Texture{.id = this->tID, .type = ""});
+        textures.push_back(Texture{.id = this->tID, .kind = TextureKind::Diffuse});
 
         this->mesh = std::make_shared<Mesh>(vertices, indices, textures);
     }
@@ -2,62 +2,400 @@
 // Created by Niccolo on 29/04/2025.
 //
 #include "lindenmayer.h"
+#include "token_stream.h"
 #include <iterator>
 #include <algorithm>
 #include <random>
+#include <cstring>
+#include <stdexcept>
 
-std::string Lindenmayer::iterate(const std::string &current_string) {
-    std::string next_string;
-    for (char c : current_string) {
-        auto it = production_rules.find(c);
-        if (it != production_rules.end()) {
-            std::string extracted = extract_rule(it->second);
+Lindenmayer::Lindenmayer(const std::map<char, std::map<std::string, float>> &production_rules, uint64_t seed)
+    : rng(seed) {
+    // Le regole in formato std::map restano il formato di authoring, qui vengono compilate
+    for (const auto &[symbol, rule] : production_rules) {
+        compile_rule(static_cast<unsigned char>(symbol), rule);
+    }
+    find_deterministic();
+}
+
+void Lindenmayer::seed(uint64_t seed) {
+    rng.seed(seed);
+    // Un nuovo seed vuol dire alberi nuovi: la cache delle derivazioni non vale più
+    trees.clear();
+    cache_bytes = 0;
+}
+
+void Lindenmayer::set_cache_budget(size_t bytes) {
+    cache_budget = bytes;
+}
 
-            next_string += extracted;
+const std::string &Lindenmayer::advance(size_t tree, const std::string &axiom, unsigned int n_iterations, uint32_t &level) {
+    while (trees.size() <= tree) {
+        trees.push_back({rng(), {}});
+    }
+    TreeDerivation &t = trees[tree];
+    const std::string &tokens = encoded_axiom(axiom);
+    if (t.levels.empty() || t.levels.front() != tokens) {
+        for (const auto &l : t.levels) {
+            cache_bytes -= l.size();
         }
-        else {
-            // Produzione identità
-            next_string += c;
+        cache_bytes += tokens.size();
+        t.levels.assign(1, tokens);
+    }
+
+    // Si riparte dall'ultimo livello noto, una passata di iterate per ogni livello mancante
+    while (t.levels.size() <= n_iterations) {
+        const auto current = static_cast<uint32_t>(t.levels.size() - 1);
+        iterate(t.levels.back(), back, t.stream, current);
+        if (cache_bytes + back.size() > cache_budget) {
+            // Il nuovo livello non entra in cache: resta in back e da lì si prosegue in profondità
+            level = current + 1;
+            return back;
         }
+        cache_bytes += back.size();
+        t.levels.emplace_back(back);
     }
-    return next_string;
+    level = n_iterations;
+    return t.levels[n_iterations];
 }
 
-std::string Lindenmayer::cleanup(const std::string &current_string) {
-    std::string next_string;
-    for (char c : current_string) {
-        if (c != 'X') {
-            next_string += c;
+const std::string &Lindenmayer::encoded_axiom(const std::string &axiom) {
+    if (axiom_tokens.empty() || axiom != axiom_symbols) {
+        axiom_symbols = axiom;
+        axiom_tokens = encode_tokens(axiom);
+    }
+    return axiom_tokens;
+}
+
+void Lindenmayer::set_worker_pool(WorkerPool *worker_pool) {
+    pool = worker_pool;
+}
+
+void Lindenmayer::set_memoization(bool enabled) {
+    memoization = enabled;
+}
+
+void Lindenmayer::find_deterministic() {
+    // Punto fisso: parte da tutte le regole con un solo successore e toglie quelle che
+    // riscrivono verso simboli stocastici (es. 'S' -> "F[^^L]" con 'F' stocastica)
+    for (unsigned int c = 0; c < 256; c++) {
+        deterministic[c] = rules[c].count == 1;
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (unsigned int c = 0; c < 256; c++) {
+            if (!deterministic[c]) {
+                continue;
+            }
+            const Successor &s = successors[rules[c].first];
+            char op;
+            unsigned int k;
+            for (uint32_t i = 0; i < s.length;) {
+                i += static_cast<uint32_t>(read_token(arena.data() + s.offset + i, op, k));
+                const auto child = static_cast<unsigned char>(op);
+                if (rules[child].count != 0 && !deterministic[child]) {
+                    deterministic[c] = false;
+                    changed = true;
+                    break;
+                }
+            }
         }
-        else {
-            next_string += 'F';
+    }
+}
+
+const Lindenmayer::MemoNode *Lindenmayer::memo(unsigned char symbol, uint32_t depth) {
+    const int32_t index = memo_index(symbol, depth);
+    return index >= 0 ? &memo_nodes[index] : nullptr;
+}
+
+int32_t Lindenmayer::memo_index(unsigned char symbol, uint32_t depth) {
+    const size_t key = static_cast<size_t>(depth) * 256 + symbol;
+    if (key >= memo_lookup.size()) {
+        memo_lookup.resize((static_cast<size_t>(depth) + 1) * 256, UNKNOWN);
+    }
+    if (memo_lookup[key] != UNKNOWN) {
+        return memo_lookup[key];
+    }
+
+    // I figli deterministici a profondità depth - 1 vengono costruiti (o recuperati) prima e il nodo
+    // li riferisce per indice: ogni (simbolo, profondità) occupa solo le parti del suo successore
+    const Successor &s = successors[rules[symbol].first];
+    if (memo_parts.size() + s.length > MEMO_PART_LIMIT) {
+        // Tabella piena: expand riscrive normalmente
+        memo_lookup[key] = TOO_LARGE;
+        return TOO_LARGE;
+    }
+    std::vector<MemoPart> parts;
+    for (uint32_t i = 0; i < s.length;) {
+        MemoPart part{0, 0, UNKNOWN};
+        i += static_cast<uint32_t>(read_token(arena.data() + s.offset + i, part.op, part.count));
+        if (depth > 1 && rules[static_cast<unsigned char>(part.op)].count != 0) {
+            part.child = memo_index(static_cast<unsigned char>(part.op), depth - 1);
+            if (part.child < 0) {
+                memo_lookup[key] = TOO_LARGE;
+                return TOO_LARGE;
+            }
+        }
+        parts.push_back(part);
+    }
+
+    const MemoNode node{static_cast<uint32_t>(memo_parts.size()), static_cast<uint32_t>(parts.size()),
+                        static_cast<uint32_t>(memo_levels.size())};
+    // Simboli occupati ai livelli relativi 1..depth-1: il livello 1 è il successore stesso
+    for (uint32_t j = 1; j < depth; j++) {
+        uint64_t count = 0;
+        for (const MemoPart &part : parts) {
+            count += part.count * ((j == 1 || part.child < 0) ? 1 : memo_levels[memo_nodes[part.child].levels + j - 2]);
         }
+        memo_levels.push_back(count);
+    }
+    memo_parts.insert(memo_parts.end(), parts.begin(), parts.end());
+    memo_lookup[key] = static_cast<int32_t>(memo_nodes.size());
+    memo_nodes.push_back(node);
+    return memo_lookup[key];
+}
+
+uint64_t Lindenmayer::counter_random(uint64_t stream, uint32_t iteration, uint64_t position) {
+    // splitmix64 sul contatore (stream, iterazione, posizione): nessuno stato da condividere tra thread
+    uint64_t z = stream + (position + 1) * 0x9E3779B97F4A7C15ull + iteration * 0xD1B54A32D192ED03ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+template<typename Writer>
+void Lindenmayer::rewrite(const std::string &current_string, size_t begin, size_t end, uint64_t stream, uint32_t iteration,
+                          uint64_t position, Writer &writer) const {
+    const char *p = current_string.data() + begin;
+    const char *last = current_string.data() + end;
+    char op;
+    unsigned int k;
+    while (p < last) {
+        p += read_token(p, op, k);
+        const CompiledRule &rule = rules[static_cast<unsigned char>(op)];
+        if (rule.count == 0) {
+            // Produzione identità: la ripetizione passa intatta
+            writer.put(op, k);
+            position += k;
+            continue;
+        }
+        // Ogni ripetizione ha la sua posizione e quindi la sua estrazione
+        for (unsigned int r = 0; r < k; r++, position++) {
+            const Successor &s = successors[rule.first + extract_rule(rule, counter_random(stream, iteration, position))];
+            writer.put_tokens(arena.data() + s.offset, arena.data() + s.offset + s.length);
+        }
+    }
+}
+
+size_t Lindenmayer::align(const std::string &current_string, size_t i) {
+    // Un blocco non può iniziare tra il prefisso di ripetizione e il suo simbolo
+    return i > 0 && i < current_string.size() && is_run_prefix(current_string[i - 1]) ? i + 1 : i;
+}
+
+void Lindenmayer::iterate(const std::string &current_string, std::string &next_string, uint64_t stream, uint32_t iteration) {
+    const size_t n = current_string.size();
+
+    if (pool == nullptr || pool->size() == 1 || n < PARALLEL_THRESHOLD) {
+        // Prima passata: le estrazioni dipendono solo dalla posizione, quindi basta contare i byte
+        TokenWriter counter;
+        rewrite(current_string, 0, n, stream, iteration, 0, counter);
+        next_string.resize(counter.size());
+        // Seconda passata: rifà le stesse estrazioni e scrive nel buffer già dimensionato
+        TokenWriter writer{next_string.data()};
+        rewrite(current_string, 0, n, stream, iteration, 0, writer);
+        return;
+    }
+
+    // Stesse passate divise in blocchi. Le posizioni sono quelle dei simboli decodificati:
+    // una passata in più conta i simboli di ogni blocco per sapere da dove parte
+    const size_t n_chunks = std::min<size_t>(pool->size() * 4, (n + PARALLEL_THRESHOLD / 4 - 1) / (PARALLEL_THRESHOLD / 4));
+    const size_t chunk = (n + n_chunks - 1) / n_chunks;
+    chunk_bounds.resize(n_chunks + 1);
+    for (size_t c = 0; c <= n_chunks; c++) {
+        chunk_bounds[c] = align(current_string, std::min(n, c * chunk));
+    }
+    chunk_positions.assign(n_chunks + 1, 0);
+    pool->parallel_for(n_chunks, [&](size_t c) {
+        chunk_positions[c + 1] = token_symbols(current_string.data() + chunk_bounds[c], current_string.data() + chunk_bounds[c + 1]);
+    });
+    chunk_offsets.assign(n_chunks + 1, 0);
+    for (size_t c = 0; c < n_chunks; c++) {
+        chunk_positions[c + 1] += chunk_positions[c];
+    }
+
+    pool->parallel_for(n_chunks, [&](size_t c) {
+        TokenWriter counter;
+        rewrite(current_string, chunk_bounds[c], chunk_bounds[c + 1], stream, iteration, chunk_positions[c], counter);
+        chunk_offsets[c + 1] = counter.size();
+    });
+    for (size_t c = 0; c < n_chunks; c++) {
+        chunk_offsets[c + 1] += chunk_offsets[c];
     }
-    return next_string;
+
+    next_string.resize(chunk_offsets[n_chunks]);
+    char *out = next_string.data();
+    pool->parallel_for(n_chunks, [&](size_t c) {
+        TokenWriter writer{out + chunk_offsets[c]};
+        rewrite(current_string, chunk_bounds[c], chunk_bounds[c + 1], stream, iteration, chunk_positions[c], writer);
+    });
 }
 
-std::string Lindenmayer::generate(const std::string &axiom, unsigned int n_iterations, bool need_cleanup) {
-    std::string next = axiom;
+const std::string &Lindenmayer::generate(const std::string &axiom, unsigned int n_iterations) {
+    // Un'estrazione dal generatore per albero, poi ogni scelta dipende solo dalla sua posizione
+    const uint64_t stream = rng();
+    // I buffer si dimensionano sulla lunghezza attesa, la stessa che clampIterations confronta col
+    // budget: il caso peggiore può superarla di ordini di grandezza. Se una generazione precedente li
+    // ha lasciati molto più grandi vengono liberati prima
+    const double expected = estimate(axiom, n_iterations).expected_length;
+    const size_t length = expected <= RESERVE_LIMIT ? static_cast<size_t>(expected) : 0;
+    release_oversized(front, length);
+    release_oversized(back, length);
+    front.reserve(length);
+    back.reserve(length);
+    front = encoded_axiom(axiom);
     for (unsigned int i = 0; i < n_iterations; i++) {
-        next = iterate(next);
+        iterate(front, back, stream, i);
+        std::swap(front, back);
     }
-    if (need_cleanup) {
-        next = cleanup(next);
+    // front è il risultato, back il livello precedente che non serve più
+    release_oversized(back, length);
+    return front;
+}
+
+void Lindenmayer::release_oversized(std::string &buffer, size_t expected) {
+    if (buffer.capacity() > std::max(expected * RELEASE_FACTOR, RELEASE_MIN)) {
+        std::string().swap(buffer);
     }
-    return next;
 }
 
-std::string Lindenmayer::extract_rule(const std::map<std::string, float>& stochastic_rule) {
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    std::uniform_real_distribution<> dist(0,1);
-    double rand = dist(rng);
-    float cumulative = 0;
-    for (const auto & it : stochastic_rule) {
-        cumulative += it.second;
-        if (rand < cumulative) {
-            return it.first;
+GrowthEstimate Lindenmayer::estimate(const std::string &axiom, unsigned int n_iterations) const {
+    // Valore atteso: conteggi dei simboli moltiplicati per la matrice di crescita pesata.
+    // Caso peggiore: per ogni simbolo il successore che produce di più, livello per livello
+    std::array<double, 256> expected{}, next{};
+    std::array<double, 256> worst_length{}, worst_modules{}, length_prev{}, modules_prev{};
+    for (unsigned int c = 0; c < 256; c++) {
+        length_prev[c] = 1.0;
+        modules_prev[c] = is_module(static_cast<char>(c)) ? 1.0 : 0.0;
+    }
+    for (char c : axiom) {
+        expected[static_cast<unsigned char>(c)] += 1.0;
+    }
+
+    for (unsigned int it = 0; it < n_iterations; it++) {
+        next.fill(0.0);
+        worst_length = length_prev;
+        worst_modules = modules_prev;
+        for (unsigned int c = 0; c < 256; c++) {
+            const CompiledRule &rule = rules[c];
+            if (rule.count == 0) {
+                next[c] += expected[c];
+                continue;
+            }
+            worst_length[c] = 0.0;
+            worst_modules[c] = 0.0;
+            for (uint32_t k = rule.first; k < rule.first + rule.count; k++) {
+                const Successor &s = successors[k];
+                double length = 0.0, modules = 0.0;
+                char op;
+                unsigned int repeat;
+                for (uint32_t i = 0; i < s.length;) {
+                    i += static_cast<uint32_t>(read_token(arena.data() + s.offset + i, op, repeat));
+                    const auto x = static_cast<unsigned char>(op);
+                    next[x] += expected[c] * weight[k] * repeat;
+                    length += length_prev[x] * repeat;
+                    modules += modules_prev[x] * repeat;
+                }
+                worst_length[c] = std::max(worst_length[c], length);
+                worst_modules[c] = std::max(worst_modules[c], modules);
+            }
         }
+        expected = next;
+        length_prev = worst_length;
+        modules_prev = worst_modules;
+    }
+
+    GrowthEstimate result;
+    for (unsigned int c = 0; c < 256; c++) {
+        result.expected_length += expected[c];
+    }
+    result.expected_branches = expected['F'] + expected['X'];
+    result.expected_leaves = expected['L'];
+    result.expected_junctions = expected['J'];
+    for (char c : axiom) {
+        result.worst_length += length_prev[static_cast<unsigned char>(c)];
+        result.worst_modules += modules_prev[static_cast<unsigned char>(c)];
     }
-    return "";
-}
\ No newline at end of file
+    return result;
+}
+
+bool Lindenmayer::is_module(char c) {
+    // 'X' diventa 'F' con la pulizia finale
+    return c == 'F' || c == 'X' || c == 'L' || c == 'J';
+}
+
+uint8_t Lindenmayer::extract_rule(const CompiledRule &stochastic_rule, uint64_t r) const {
+    // Un solo numero a 64 bit: i 32 bit alti scelgono la colonna, quelli bassi la moneta
+    const uint32_t column = stochastic_rule.first + static_cast<uint32_t>(((r >> 32) * stochastic_rule.count) >> 32);
+    const float coin = static_cast<float>(r & 0xFFFFFFFFu) * 0x1.0p-32f;
+    if (coin < probability[column]) {
+        return static_cast<uint8_t>(column - stochastic_rule.first);
+    }
+    return static_cast<uint8_t>(alias[column] - stochastic_rule.first);
+}
+
+void Lindenmayer::compile_rule(unsigned char symbol, const std::map<std::string, float> &stochastic_rule) {
+    if (is_run_prefix(static_cast<char>(symbol))) {
+        throw std::runtime_error("Errore: i simboli delle regole devono essere ASCII.");
+    }
+    const auto first = static_cast<uint32_t>(successors.size());
+    std::vector<double> weights;
+    double total = 0;
+    for (const auto &[successor, weight] : stochastic_rule) {
+        if (std::any_of(successor.begin(), successor.end(), is_run_prefix)) {
+            throw std::runtime_error("Errore: i simboli delle regole devono essere ASCII.");
+        }
+        // I successori vengono salvati già codificati, così iterate li copia token per token
+        const std::string tokens = encode_tokens(successor);
+        successors.push_back({static_cast<uint32_t>(arena.size()), static_cast<uint32_t>(tokens.size())});
+        arena += tokens;
+        weights.push_back(weight);
+        total += weight;
+    }
+    // Se i pesi sommano a meno di 1 la parte mancante cancellava il simbolo: la manteniamo
+    if (total < 1.0) {
+        successors.push_back({static_cast<uint32_t>(arena.size()), 0});
+        weights.push_back(1.0 - total);
+        total = 1.0;
+    }
+
+    const size_t n = weights.size();
+    if (n >= IDENTITY) {
+        throw std::runtime_error("Errore: troppi successori per una regola stocastica.");
+    }
+    probability.resize(first + n, 1.0f);
+    alias.resize(first + n);
+    for (size_t i = 0; i < n; i++) {
+        weight.push_back(static_cast<float>(weights[i] / total));
+    }
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < n; i++) {
+        alias[first + i] = first + static_cast<uint32_t>(i);
+        scaled[i] = weights[i] * static_cast<double>(n) / total;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+    while (!small.empty() && !large.empty()) {
+        const uint32_t s = small.back();
+        small.pop_back();
+        const uint32_t l = large.back();
+        probability[first + s] = static_cast<float>(scaled[s]);
+        alias[first + s] = first + l;
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    rules[symbol] = {first, static_cast<uint32_t>(n)};
+}
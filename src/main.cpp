@@ -2,8 +2,10 @@
 // Created by Niccolo on 31/03/2025.
 //
 #include <iostream>
+#include <cmath>
 #include <cstdio>
 #include <memory>
+#include <random>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -17,6 +19,9 @@
 #include "shader.h"
 #include "PoissonGenerator.h"
 #include "tree.h"
+#include "scene_renderer.h"
+#include "frame_uniforms.h"
+#include "gl_state.h"
 #include "../lib/imgui-master/imgui.h"
 #include "../lib/imgui-master/backends/imgui_impl_glfw.h"
 #include "../lib/imgui-master/backends/imgui_impl_opengl3.h"
@@ -80,6 +85,24 @@ int main() {
     auto waterShader = Shader("../shaders/water.vert", "../shaders/water.frag");
     auto boxShader = Shader("../shaders/box.vert", "../shaders/box.frag");
     auto t_shader = Shader("../shaders/vshader.glsl", "../shaders/fshader.glsl");
+    auto bakeShader = Shader("../shaders/vshader.glsl", "../shaders/impostor_bake.frag");
+    auto impostorShader = Shader("../shaders/impostor.vert", "../shaders/impostor.frag");
+    // Uniform impostati a ogni frame, risolti una volta dopo il link
+    const auto treeAlphaDiscard = t_shader.uniform<float>("alpha_discard");
+    const auto impostorAlphaDiscard = impostorShader.uniform<float>("alpha_discard");
+    const auto waterModel = waterShader.uniform<glm::mat4>("model");
+    const auto waveFrequency = waterShader.uniform<float>("waveFrequency");
+    const auto waveAmplitude = waterShader.uniform<float>("waveAmplitude");
+    const auto waveSpeed = waterShader.uniform<float>("waveSpeed");
+    const auto boxShininess = boxShader.uniform<float>("material.shininess");
+    // Camera, luce e tempo in un unico uniform buffer condiviso da tutti i programmi
+    FrameUniforms frameUniforms;
+    FrameData frameData;
+    frameData.lightDirection = glm::vec4(-0.3f, -1.0f, -0.3f, 0.0f);
+    frameData.lightAmbient = glm::vec4(0.3f, 0.3f, 0.3f, 0.0f); // era 0.2
+    frameData.lightDiffuse = glm::vec4(0.7f, 0.7f, 0.7f, 0.0f); // era 0.5
+    frameData.lightSpecular = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+    frameUniforms.update(frameData);
 
 
     // Create a Noise generator
@@ -99,21 +122,52 @@ int main() {
     }
 
     const Mesh wall = setWall();
+    const std::vector<ArenaInstance> walls = wallInstances();
     boxShader.use();
 
 
     // L-System tree creation
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
+    GLState::setEnabled(GL_BLEND, true);
+    GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::setEnabled(GL_CULL_FACE, true);
+    GLState::setEnabled(GL_DEPTH_TEST, true);
 
     float minTreeDistance = 5.0f;  // Assicurati che sia di tipo float
 
     auto treePos = generateTreePositions(elevation, biome, minTreeDistance);
     TreeConfig config = getConfig(biome);
-    auto trees = treeStrings(config, treePos.size());
-    auto forest = makeForest(trees, config);
+    GenerationBudget budget;
+    // Seed della foresta: cambia solo quando si chiedono alberi nuovi
+    std::random_device seeder;
+    uint64_t forestSeed = seeder();
+    // Tiene in cache le derivazioni di ogni albero tra una modifica e l'altra dei parametri
+    Lindenmayer lsystem(config.production_rules, forestSeed);
+    auto forest = makeForest(config, lsystem, treePos.size(), budget);
+    // Terreno, muri e foresta in un'unica arena, ricaricata solo quando la scena cambia
+    constexpr float treeScale = 0.2f;
+    SceneRenderer scene;
+    scene.resolveUniforms(impostorShader);
+    const auto uploadScene = [&]() {
+        scene.upload(forest, treeOrigins(elevation, treePos), treeScale, elevation, wall, walls);
+        // Gli impostor degli alberi lontani si cuociono insieme alla foresta
+        bakeShader.use();
+        bakeShader.setFloat("alpha_discard", config.alpha_discard);
+        scene.bakeImpostors(bakeShader, frameUniforms);
+    };
+    uploadScene();
+    // Costo previsto della foresta: cambia solo con configurazione, posizioni o budget
+    GrowthEstimate estimate;
+    int allowedIterations = 0;
+    const auto refreshEstimate = [&]() {
+        estimate = estimateForest(lsystem, config, treePos.size());
+        allowedIterations = clampIterations(lsystem, config, treePos.size(), budget);
+    };
+    refreshEstimate();
+    const auto rebuildForest = [&]() {
+        refreshEstimate();
+        forest = makeForest(config, lsystem, treePos.size(), budget);
+        uploadScene();
+    };
 
     // Check for OpenGL errors BEFORE entering the render loop
     GLenum err;
@@ -148,8 +202,9 @@ int main() {
             elevation = setElevation(biome, shader);
             treePos = generateTreePositions(elevation, biome, minTreeDistance);
             config = getConfig(biome);
-            trees = treeStrings(config, treePos.size());
-            forest = makeForest(trees, config);
+            forestSeed = seeder();
+            lsystem = Lindenmayer(config.production_rules, forestSeed);
+            rebuildForest();
         }
         ImGui::PopItemWidth();  // Ripristina la larghezza predefinita
 
@@ -158,32 +213,73 @@ int main() {
         ImGui::Text("Distanza attuale: %.2f", minTreeDistance);  // Mostra la distanza attuale
 
         // Box per numero di iterazioni per la generazione degli alberi
-        ImGui::InputInt("Numero iterazioni", &config.production_iterations, 1, 1);
+        if (ImGui::InputInt("Numero iterazioni", &config.production_iterations, 1, 1)) {
+            // I livelli già derivati sono in cache: +1 costa una passata, -1 è immediato
+            config.production_iterations = std::max(config.production_iterations, 0);
+            rebuildForest();
+        }
         ImGui::Text("Numero di iterazioni eseguite: %d", config.production_iterations);
 
+        // Costo previsto della foresta prima di generarla
+        ImGui::Text("Moduli attesi: %.0f (max %.0f), simboli attesi: %.0f",
+                    estimate.expected_modules(), estimate.worst_modules, estimate.expected_length);
+        ImGui::Text("Memoria prevista: %.1f MB", estimate.expected_modules() * sizeof(ModuleInstance) / (1024.0 * 1024.0));
+        if (allowedIterations < config.production_iterations) {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.2f, 1.0f), "Oltre il budget: verranno generate %d iterazioni", allowedIterations);
+        }
+        if (ImGui::InputFloat("Budget memoria (MB)", &budget.max_memory_mb, 64.0f, 256.0f, "%.0f")) {
+            refreshEstimate();
+        }
+        if (ImGui::InputFloat("Budget simboli", &budget.max_symbols, 1e7f, 1e8f, "%.0f")) {
+            refreshEstimate();
+        }
+        if (ImGui::InputFloat("Budget cache derivazioni (MB)", &budget.max_cache_mb, 64.0f, 256.0f, "%.0f")) {
+            // Vale dalla prossima derivazione: i livelli già in cache restano
+            budget.max_cache_mb = std::max(budget.max_cache_mb, 0.0f);
+            lsystem.set_cache_budget(static_cast<size_t>(budget.max_cache_mb * 1024.0 * 1024.0));
+        }
+        if (ImGui::InputFloat("Budget alberi cotti (MB)", &budget.max_baked_mb, 64.0f, 256.0f, "%.0f")) {
+            // Quali alberi cuocere si decide in makeForest; le derivazioni sono in cache
+            budget.max_baked_mb = std::max(budget.max_baked_mb, 0.0f);
+            rebuildForest();
+        }
+        ImGui::Text("Derivazioni in cache: %.1f MB", static_cast<double>(lsystem.cached_bytes()) / (1024.0 * 1024.0));
+        ImGui::Text("Alberi per livello: %zu completi, %zu ridotti, %zu impostor (%zu varianti)",
+                    scene.treesAtLevel(0), scene.treesAtLevel(1), scene.treesAtLevel(2), scene.bakedVariants());
+        ImGui::Text("Alberi fuori dal frustum: %zu", scene.culledTrees());
+        ImGui::Text("Cambi di stato GL: %u eseguiti, %u saltati", GLState::lastFrame().issued, GLState::lastFrame().skipped);
+        if (const std::optional<size_t> picked = scene.pickTree(camera.position, camera.front)) {
+            ImGui::Text("Albero davanti alla camera: %zu", *picked);
+        }
+
         // Box per lunghezza moduli dell'albero
         if (ImGui::InputFloat("Lunghezza moduli", &config.branch_length, 0.1f, 1.0f, "%.2f")) {
-            forest = makeForest(trees, config);
+            rebuildForest();
         }
 
         // Box per raggio moduli dell'albero
         if (ImGui::InputFloat("Raggio moduli", &config.branch_radius, 0.05f, 1.0f, "%.2f")) {
-            forest = makeForest(trees, config);
+            rebuildForest();
         }
 
         // Box per risoluzione moduli dell'albero
         if (ImGui::InputScalar("Risoluzione moduli", ImGuiDataType_U32, &config.resolution)) {
-            forest = makeForest(trees, config);
+            rebuildForest();
+        }
+
+        // Corteccia come tubi continui o come cilindri e giunzioni
+        if (ImGui::Checkbox("Rami continui", &config.swept_branches)) {
+            rebuildForest();
         }
 
         // Box per decidere grandezza foglia
         if (ImGui::InputFloat("Lunghezza foglie", &config.leaf_size, 0.1f, 1.0f, "%.2f")) {
-            forest = makeForest(trees, config);
+            rebuildForest();
         }
 
         // Box per angolo rami
         if (ImGui::InputFloat("Angolo rotazioni", &config.angle, 0.5f, 1.0f, "%.2f")) {
-            forest = makeForest(trees, config);
+            rebuildForest();
         }
 
         // Pulsante per ricaricare il bioma con impostazioni differenti
@@ -191,21 +287,22 @@ int main() {
             biome = static_cast<Biomes>(selectedIndex);
             elevation = setElevation(biome, shader);
             treePos = generateTreePositions(elevation, biome, minTreeDistance);
-            trees = treeStrings(config, treePos.size());
-            forest = makeForest(trees, config);
+            rebuildForest();
         }
         ImGui::SameLine();
         // Pulsante per generare nuovi alberi nelle stesse posizioni
         if (ImGui::Button("Ricarica Alberi", ImVec2(200, 20))) {
-            trees = treeStrings(config, treePos.size());
-            forest = makeForest(trees, config);
+            forestSeed = seeder();
+            lsystem.seed(forestSeed);
+            rebuildForest();
         }
         ImGui::SameLine();
         // Pulsante per generare nuovi alberi in nuove posizioni
         if (ImGui::Button("Genera Nuove Posizioni", ImVec2(200, 20))) {
             treePos = generateTreePositions(elevation, biome, minTreeDistance);
-            trees = treeStrings(config, treePos.size());
-            forest = makeForest(trees, config);
+            forestSeed = seeder();
+            lsystem.seed(forestSeed);
+            rebuildForest();
         }
 
         ImGui::End();
@@ -222,81 +319,55 @@ int main() {
         glm::mat4 view = camera.GetViewMatrix();
         auto model = glm::mat4(1.0f);
 
+        // Culling sul frustum e livello di dettaglio di ogni albero dalla sua altezza sullo schermo
+        const float pixelsPerUnit = static_cast<float>(SCR_HEIGHT) / (2.0f * std::tan(glm::radians(camera.zoom) / 2.0f));
+        scene.updateVisibility(camera.position, camera.GetFrustum(projection), pixelsPerUnit);
+
+        frameData.setCamera(view, projection, camera.position);
+        frameData.time.x = static_cast<float>(glfwGetTime());
+        frameUniforms.update(frameData);
+
         //skybox always first
-        glDepthMask(GL_FALSE);
-        glDisable(GL_DEPTH_TEST);
+        GLState::depthMask(false);
+        GLState::setEnabled(GL_DEPTH_TEST, false);
         skyShader.use();
-        auto viewNoTranslate = glm::mat4(glm::mat3(camera.GetViewMatrix()));
-        skyShader.setMat4("view", viewNoTranslate);
-        skyShader.setMat4("projection", projection);
-        skybox.render(skyShader);
-        glDepthMask(GL_TRUE);
-        glEnable(GL_DEPTH_TEST);
+        skybox.render();
+        GLState::depthMask(true);
+        GLState::setEnabled(GL_DEPTH_TEST, true);
 
         // Stuff
         shader.use();
-        shader.setMat4("model", model); // identity for terrain
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
-        shader.setVec3("dirLight.direction", glm::vec3(-0.3f, -1.0f, -0.3f));
-        shader.setVec3("dirLight.ambient", glm::vec3(0.3f, 0.3f, 0.3f)); // era 0.2
-        shader.setVec3("dirLight.diffuse", glm::vec3(0.7f, 0.7f, 0.7f)); // era 0.5
-        shader.setVec3("dirLight.specular", glm::vec3(1.0f, 1.0f, 1.0f)); // ok
-        shader.setVec3("viewPos", camera.position);
-        shader.setFloat("time", static_cast<float>(glfwGetTime()));
-
-
-        elevation.render(shader);
+
+
+        scene.renderTerrain();
         t_shader.use();
-        t_shader.setMat4("view", view);
-        t_shader.setMat4("projection", projection);
-        t_shader.setVec3("light.direction", -0.3f, -1.0f, -0.3f);
-        t_shader.setVec3("viewPos", camera.position);
-        t_shader.setVec3("light.ambient", 0.3f, 0.3f, 0.3f);
-        t_shader.setVec3("light.diffuse", 0.7f, 0.7f, 0.7f);
-        t_shader.setFloat("alpha_discard", config.alpha_discard);
-
-        for (int i = 0; i < forest.size(); i++) {
-            const float y = elevation.getHeight(treePos[i].x, treePos[i].y);
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(treePos[i].x, y, treePos[i].y));
-            model = glm::scale(model, glm::vec3(0.2f));
-            forest[i].render(t_shader, model);
-        }
+        Shader::set(treeAlphaDiscard, config.alpha_discard);
+
+        // Due passaggi indiretti per tutta la foresta: corteccia e foglie
+        scene.renderTrees();
+
+        // Gli alberi lontani sono un quadrato ciascuno
+        impostorShader.use();
+        Shader::set(impostorAlphaDiscard, 0.5f);
+        scene.renderImpostors();
 
         if (biome == Biomes::ISLANDS) {
             waterShader.use();
-            waterShader.setMat4("view", view);
-            waterShader.setMat4("projection", projection);
-            waterShader.setFloat("time", static_cast<float>(glfwGetTime()));
             model = glm::mat4(1.0f);
             model = glm::translate(model, glm::vec3(0.0f, 0.45f, 0.0f)); // Traslazione per posizionare sopra
-            waterShader.setMat4("model", glm::scale(model, glm::vec3(1.0f))); // Traslazione per posizionare sopra
-            waterShader.setFloat("waveFrequency", 3.0f); // Più alto = onde più fitte
-            waterShader.setFloat("waveAmplitude", 0.05f); // Più alto = onde più alte
-            waterShader.setFloat("waveSpeed", 1.5f); // Più alto = onde più veloci
-            Water.render(waterShader);
+            Shader::set(waterModel, glm::scale(model, glm::vec3(1.0f))); // Traslazione per posizionare sopra
+            Shader::set(waveFrequency, 3.0f); // Più alto = onde più fitte
+            Shader::set(waveAmplitude, 0.05f); // Più alto = onde più alte
+            Shader::set(waveSpeed, 1.5f); // Più alto = onde più veloci
+            Water.render();
         }
         //walls
         boxShader.use();
-        boxShader.setMat4("view", view);
-        boxShader.setMat4("projection", projection);
-        boxShader.setVec3("dirLight.direction", glm::vec3(-0.3f, -1.0f, -0.3f));
-        boxShader.setVec3("dirLight.ambient", glm::vec3(0.3f, 0.3f, 0.3f)); // era 0.2
-        boxShader.setVec3("dirLight.diffuse", glm::vec3(0.7f, 0.7f, 0.7f)); // era 0.5
-        boxShader.setVec3("dirLight.specular", glm::vec3(1.0f, 1.0f, 1.0f)); // ok
-        boxShader.setFloat("material.shininess", 32.0f);
-        boxShader.setVec3("viewPos", camera.position);
-        for (int i = 0; i < 4; i++) {
-            model = glm::mat4(1.0f);
-            model = glm::rotate(model, glm::radians(90.0f * i), glm::vec3(0.0f, 1.0f, 0.0f));
-            if (i == 0) model = glm::translate(model, glm::vec3(-0.5f, 0.0f, -0.5f));
-            else if (i == 1) model = glm::translate(model, glm::vec3(0.0f, 0.0f, -0.5f));
-            else if (i == 2) model = glm::translate(model, glm::vec3(-19.5f, 0.0f, -19.5f));
-            else if (i == 3) model = glm::translate(model, glm::vec3(19.0f, 0.0f, -19.5f));
-            boxShader.setMat4("model", model);
-            wall.render(boxShader);
-        }
+        Shader::set(boxShininess, 32.0f);
+        // I quattro muri sono istanze della stessa mesh
+        scene.renderWalls();
+        GLState::endFrame();
+        // ImGui salva e ripristina lo stato che tocca, la cache resta valida
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
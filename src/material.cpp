@@ -0,0 +1,40 @@
+//
+// Created by Niccolo on 01/07/2025.
+//
+
+#include "material.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+Material::Material(std::vector<Texture> textures) : source(std::move(textures)) {
+    if (source.empty()) {
+        return;
+    }
+    std::array<GLuint, TEXTURE_UNIT_BASE.size()> used{};
+    std::vector<GLuint> unit_of(source.size());
+    GLuint lowest = std::numeric_limits<GLuint>::max(), highest = 0;
+    for (size_t i = 0; i < source.size(); i++) {
+        const auto kind = static_cast<size_t>(source[i].kind);
+        if (used[kind] >= TEXTURE_UNIT_COUNT[kind]) {
+            throw std::runtime_error("Errore: troppe texture dello stesso tipo nel materiale");
+        }
+        unit_of[i] = TEXTURE_UNIT_BASE[kind] + used[kind]++;
+        lowest = std::min(lowest, unit_of[i]);
+        highest = std::max(highest, unit_of[i]);
+    }
+    first = lowest;
+    units.assign(highest - lowest + 1, 0);
+    for (size_t i = 0; i < source.size(); i++) {
+        units[unit_of[i] - first] = source[i].id;
+    }
+}
+
+void Material::bind() const {
+    if (!units.empty()) {
+        GLState::bindTextures(first, static_cast<GLsizei>(units.size()), units.data());
+    }
+}
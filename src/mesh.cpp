@@ -9,53 +9,25 @@
 #include <iostream>
 #include <glad/glad.h>
 
+#include "gl_state.h"
+
 
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices,
            std::vector<Texture> textures) : vertices(std::move(vertices)),
                                             indices(std::move(indices)),
-                                            textures(std::move(textures)) {
+                                            material(std::move(textures)) {
     this->setupMesh();
 }
 
-void Mesh::render(const Shader &shader) const {
-    // bind appropriate textures
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
-    unsigned int heightNr = 1;
-    for (unsigned int i = 0; i < textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-        // retrieve texture number (the N in diffuse_textureN)
-        std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
-        else if (name == "texture_specular")
-            number = std::to_string(specularNr++); // transfer unsigned int to string
-        else if (name == "texture_normal")
-            number = std::to_string(normalNr++); // transfer unsigned int to string
-        else if (name == "texture_height")
-            number = std::to_string(heightNr++); // transfer unsigned int to string
-
-        // now set the sampler to the correct texture unit
-        glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-        // and finally bind the texture
-        if (name == "texture_cubemap")
-            glBindTexture(GL_TEXTURE_CUBE_MAP, textures[i].id);
-        else
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-    }
+void Mesh::render() const {
+    material.bind();
 
-    glBindVertexArray(this->VAO);
+    GLState::bindVertexArray(this->VAO);
     if (indices.size() > 0) {
         glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
     } else {
         glDrawArrays(GL_TRIANGLES, 0, vertices.size());
     }
-
-    glBindVertexArray(0);
-
-    glActiveTexture(GL_TEXTURE0);
 }
 
 void Mesh::setupMesh() {
@@ -63,7 +35,7 @@ void Mesh::setupMesh() {
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
+    GLState::bindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
     glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
@@ -82,7 +54,7 @@ void Mesh::setupMesh() {
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                           reinterpret_cast<void *>(offsetof(Vertex, texCoords)));
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 }
 
 float Mesh::getHeight(const float x, const float z) const {
@@ -126,3 +98,11 @@ float Mesh::getHeight(const float x, const float z) const {
 
     return h;
 }
+
+Bounds Mesh::getBounds() const {
+    Bounds bounds;
+    for (const Vertex &v : vertices) {
+        bounds.expand(v.position);
+    }
+    return bounds;
+}
@@ -0,0 +1,506 @@
+//
+// Created by Niccolo on 24/06/2025.
+//
+
+#include "scene_renderer.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+SceneRenderer::~SceneRenderer() {
+    releaseImpostors();
+}
+
+void SceneRenderer::upload(const std::vector<Tree> &forest, const std::vector<glm::vec3> &origins, float tree_scale,
+                           const Mesh &terrain_mesh, const Mesh &wall_mesh, const std::vector<ArenaInstance> &wall_instances) {
+    arena.clear();
+    bark.clear();
+    leaves.clear();
+    terrain.clear();
+    walls.clear();
+    impostors.clear();
+
+    terrain.add(arena.add(terrain_mesh));
+    terrain_material = terrain_mesh.material;
+    terrain_bounds = terrain_mesh.getBounds();
+    terrain_visible = true;
+
+    // Un comando per muro: il culling ne azzera le istanze una per una
+    const ArenaRange wall_range = arena.add(wall_mesh);
+    const Bounds wall_local = wall_mesh.getBounds();
+    wall_base = arena.add_instances(wall_instances);
+    wall_bounds.clear();
+    wall_commands.clear();
+    for (size_t i = 0; i < wall_instances.size(); i++) {
+        const ArenaInstance &w = wall_instances[i];
+        const glm::quat orientation(w.orientation.w, w.orientation.x, w.orientation.y, w.orientation.z);
+        wall_bounds.push_back(wall_local.transformed(w.position, orientation, w.scale));
+        wall_commands.push_back(walls.add(wall_range, 1, wall_base + static_cast<uint32_t>(i)));
+    }
+    wall_material = wall_mesh.material;
+
+    counts.fill(0);
+    level_counts.fill(0);
+    culled = 0;
+    variants.clear();
+    lod_trees.clear();
+    lod_instances.clear();
+    lod_at.clear();
+    changed_variants.clear();
+    lod_dirty_first = UINT32_MAX;
+    lod_dirty_last = 0;
+    module_trees.clear();
+    tree_spheres.clear();
+    const size_t tree_count = std::min(forest.size(), origins.size());
+    tree_slot.assign(tree_count, SpatialIndex::NONE);
+    scale = tree_scale;
+    if (!forest.empty()) {
+        bark_material = forest.front().getMesh(TurtleOpKind::Branch)->material;
+        leaf_material = forest.front().getMesh(TurtleOpKind::Leaf)->material;
+    }
+
+    // Varianti cotte: la geometria di ogni livello entra una volta nell'arena, ogni albero che la usa
+    // è un'istanza. Le istanze di una variante sono contigue e tutte le varianti formano un solo blocco
+    std::unordered_map<const BakedTree *, std::vector<size_t>> users;
+    std::vector<std::shared_ptr<const BakedTree>> order;
+    for (size_t i = 0; i < forest.size() && i < origins.size(); i++) {
+        if (const std::shared_ptr<const BakedTree> &baked = forest[i].getBaked()) {
+            auto [it, added] = users.try_emplace(baked.get());
+            if (added) {
+                order.push_back(baked);
+            }
+            it->second.push_back(i);
+        }
+    }
+
+    // Quadrato [-1, 1]² degli impostor e istanza identità per cuocerli
+    impostor_quad = arena.add({
+        {glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 0.0f)},
+        {glm::vec3(1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 0.0f)},
+        {glm::vec3(-1.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 1.0f)},
+        {glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 1.0f)}
+    }, {0, 1, 2, 2, 1, 3});
+    identity_instance = arena.add_instances({{glm::vec3(0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(1.0f)}});
+
+    lod_base = 0;
+    std::vector<glm::vec4> bounds;
+    for (const std::shared_ptr<const BakedTree> &baked : order) {
+        const std::vector<size_t> &trees = users[baked.get()];
+        staging.clear();
+        for (const size_t i : trees) {
+            staging.push_back({origins[i], glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec3(tree_scale)});
+            const auto position = static_cast<uint32_t>(lod_trees.size());
+            lod_at.push_back(position);
+            lod_trees.push_back({static_cast<uint32_t>(variants.size()), position, 0, 0});
+            tree_slot[i] = static_cast<uint32_t>(tree_spheres.size());
+            tree_spheres.push(origins[i] + tree_scale * baked->center(), tree_scale * baked->radius());
+        }
+
+        LodVariant variant{};
+        variant.tree = baked;
+        variant.count = static_cast<uint32_t>(trees.size());
+        variant.base = arena.add_instances(staging);
+        if (variants.empty()) {
+            lod_base = variant.base;
+        }
+        lod_instances.insert(lod_instances.end(), staging.begin(), staging.end());
+        // Tutti gli alberi partono dal livello completo
+        variant.start.fill(variant.count);
+        variant.start[0] = 0;
+        variant.changed = false;
+        for (size_t l = 0; l < BAKED_LEVELS; l++) {
+            const BakedGeometry &wood = baked->of(BakedMaterial::Bark, l);
+            const BakedGeometry &foliage = baked->of(BakedMaterial::Leaf, l);
+            const ArenaRange wood_range = arena.add(wood.vertices, wood.indices);
+            const ArenaRange foliage_range = arena.add(foliage.vertices, foliage.indices);
+            if (l == 0) {
+                variant.full = {wood_range, foliage_range};
+            }
+            // Finché updateVisibility non sceglie i livelli, tutti gli alberi usano la mesh completa
+            const uint32_t count = l == 0 ? variant.count : 0;
+            variant.bark_commands[l] = bark.add(wood_range, variant.count, variant.base);
+            variant.leaf_commands[l] = leaves.add(foliage_range, variant.count, variant.base);
+            bark.set_instances(variant.bark_commands[l], count, variant.base);
+            leaves.set_instances(variant.leaf_commands[l], count, variant.base);
+        }
+        // Un comando impostor per variante, nello stesso ordine: gl_DrawID è l'indice della variante
+        impostors.set_instances(impostors.add(impostor_quad, variant.count, variant.base), 0, variant.base);
+        bounds.emplace_back(baked->center(), baked->radius());
+        variants.push_back(std::move(variant));
+    }
+
+    // Gli altri alberi condividono le mesh dei moduli, con le istanze già posizionate sul terreno.
+    // Le istanze di ogni albero sono contigue e hanno un comando per tipo
+    for (size_t i = 0; i < forest.size() && i < origins.size(); i++) {
+        if (!forest[i].getBaked()) {
+            const Bounds &bounds = forest[i].getBounds();
+            tree_slot[i] = static_cast<uint32_t>(tree_spheres.size());
+            tree_spheres.push(origins[i] + tree_scale * bounds.center(), tree_scale * bounds.radius());
+            module_trees.push_back({});
+        }
+    }
+    for (size_t k = 0; k < MODULE_KINDS; k++) {
+        const auto kind = static_cast<TurtleOpKind>(k);
+        if (forest.empty()) {
+            continue;
+        }
+        staging.clear();
+        size_t t = 0;
+        for (size_t i = 0; i < forest.size() && i < origins.size(); i++) {
+            if (forest[i].getBaked()) {
+                continue;
+            }
+            const std::vector<ModuleInstance> &modules = forest[i].getModules().of(kind);
+            module_trees[t].base[k] = static_cast<uint32_t>(staging.size());
+            module_trees[t].count[k] = static_cast<uint32_t>(modules.size());
+            t++;
+            for (const ModuleInstance &m : modules) {
+                staging.push_back({
+                    origins[i] + tree_scale * m.position,
+                    glm::vec4(m.orientation.x, m.orientation.y, m.orientation.z, m.orientation.w),
+                    tree_scale * m.scale
+                });
+            }
+        }
+        counts[k] = staging.size();
+        const Mesh &mesh = *forest.front().getMesh(kind);
+        const ArenaRange range = arena.add(mesh);
+        const uint32_t base = arena.add_instances(staging);
+        IndirectPass &pass = kind == TurtleOpKind::Leaf ? leaves : bark;
+        for (ModuleTree &tree : module_trees) {
+            tree.base[k] += base;
+            tree.commands[k] = pass.add(range, tree.count[k], tree.base[k]);
+        }
+    }
+    // Dopo l'upload tutti gli alberi sono visibili al livello completo
+    tree_visible.assign(tree_spheres.size(), 1);
+    level_counts[0] = lod_trees.size();
+    visible_slots.resize(tree_spheres.size());
+    for (size_t s = 0; s < visible_slots.size(); s++) {
+        visible_slots[s] = static_cast<uint32_t>(s);
+    }
+    seen_frame.assign(tree_spheres.size(), 0);
+    visibility_frame = 0;
+
+    // L'indice si ricrea solo se cambia il terreno; altrimenti ogni albero viene spostato
+    // nella sua nuova cella e quelli in più vengono tolti
+    const Bounds &world = index.world();
+    if (world.empty() || world.min != terrain_bounds.min || world.max != terrain_bounds.max) {
+        index.reset(terrain_bounds);
+    }
+    for (size_t i = 0; i < tree_count; i++) {
+        const uint32_t slot = tree_slot[i];
+        index.update(static_cast<uint32_t>(i), glm::vec3(tree_spheres.x[slot], tree_spheres.y[slot], tree_spheres.z[slot]),
+                     tree_spheres.r[slot]);
+    }
+    index.truncate(static_cast<uint32_t>(tree_count));
+    index.refit();
+
+    arena.upload();
+    bark.upload();
+    leaves.upload();
+    terrain.upload();
+    walls.upload();
+    impostors.upload();
+
+    // Centro e raggio di ogni variante, letti dallo shader degli impostor con gl_DrawID
+    if (impostorBounds == 0) {
+        glGenBuffers(1, &impostorBounds);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, impostorBounds);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(bounds.size() * sizeof(glm::vec4)), bounds.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void SceneRenderer::releaseImpostors() {
+    if (impostorAlbedo != 0) {
+        const GLuint atlas[2] = {impostorAlbedo, impostorNormals};
+        GLState::deleteTextures(2, atlas);
+        impostorAlbedo = impostorNormals = 0;
+    }
+    impostor_material = Material();
+    if (impostorBounds != 0) {
+        glDeleteBuffers(1, &impostorBounds);
+        impostorBounds = 0;
+    }
+    impostor_layers = 0;
+}
+
+void SceneRenderer::bakeImpostors(Shader &shader, FrameUniforms &frame) {
+    if (impostorAlbedo != 0) {
+        const GLuint atlas[2] = {impostorAlbedo, impostorNormals};
+        GLState::deleteTextures(2, atlas);
+        impostorAlbedo = impostorNormals = 0;
+    }
+    impostor_material = Material();
+    impostor_layers = static_cast<int>(std::min(variants.size(), MAX_IMPOSTOR_LAYERS));
+    if (impostor_layers == 0) {
+        return;
+    }
+
+    constexpr GLsizei width = IMPOSTOR_TILE * IMPOSTOR_VIEWS;
+    constexpr GLsizei height = IMPOSTOR_TILE;
+    // Le mipmap si fermano alla vista di un pixel per non mescolare viste vicine
+    const auto mip_levels = static_cast<GLsizei>(std::log2(IMPOSTOR_TILE)) + 1;
+    const auto make_array = [&](unsigned int &texture) {
+        glGenTextures(1, &texture);
+        GLState::bindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, mip_levels, GL_RGBA8, width, height, impostor_layers);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mip_levels - 1);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    };
+    make_array(impostorAlbedo);
+    make_array(impostorNormals);
+
+    // Stato da ripristinare alla fine
+    GLint previous_framebuffer = 0;
+    GLint viewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const bool blend = GLState::isEnabled(GL_BLEND);
+    const bool depth_test = GLState::isEnabled(GL_DEPTH_TEST);
+
+    unsigned int framebuffer, depth;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    constexpr GLenum attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, attachments);
+    GLState::setEnabled(GL_BLEND, false);
+    GLState::setEnabled(GL_DEPTH_TEST, true);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+    shader.use();
+    const FrameData saved = frame.data();
+    FrameData bake = saved;
+    arena.bind();
+    for (int layer = 0; layer < impostor_layers; layer++) {
+        const LodVariant &variant = variants[layer];
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, impostorAlbedo, 0, layer);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, impostorNormals, 0, layer);
+        glViewport(0, 0, width, height);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Proiezione ortografica sulla sfera che contiene l'albero: il quadrato dell'impostor ha lo stesso raggio
+        const glm::vec3 center = variant.tree->center();
+        const float radius = std::max(variant.tree->radius(), 1e-4f);
+        const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.5f * radius, 3.5f * radius);
+        for (int view = 0; view < IMPOSTOR_VIEWS; view++) {
+            // Vista k dall'azimut 2πk / IMPOSTOR_VIEWS, come la sceglie impostor.vert
+            const float azimuth = glm::two_pi<float>() * static_cast<float>(view) / IMPOSTOR_VIEWS;
+            const glm::vec3 forward(std::sin(azimuth), 0.0f, std::cos(azimuth));
+            const glm::vec3 eye = center + 2.0f * radius * forward;
+            bake.setCamera(glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f)), projection, eye);
+            frame.update(bake);
+            glViewport(view * IMPOSTOR_TILE, 0, IMPOSTOR_TILE, IMPOSTOR_TILE);
+            bark_material.bind();
+            arena.draw(variant.full[static_cast<size_t>(BakedMaterial::Bark)], identity_instance);
+            leaf_material.bind();
+            arena.draw(variant.full[static_cast<size_t>(BakedMaterial::Leaf)], identity_instance);
+        }
+    }
+    frame.update(saved);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depth);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLState::setEnabled(GL_BLEND, blend);
+    GLState::setEnabled(GL_DEPTH_TEST, depth_test);
+
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, impostorAlbedo);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, impostorNormals);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    // Colore e normali vanno nelle unità di diffuse e normal, come i sampler di impostor.frag
+    impostor_material = Material({{impostorAlbedo, TextureKind::Diffuse}, {impostorNormals, TextureKind::Normal}});
+}
+
+void SceneRenderer::updateVisibility(const glm::vec3 &eye, const Frustum &frustum, float pixels_per_unit) {
+    terrain_visible = frustum.intersects(terrain_bounds);
+    for (size_t i = 0; i < wall_commands.size(); i++) {
+        walls.set_instances(wall_commands[i], frustum.intersects(wall_bounds[i]) ? 1 : 0, wall_base + static_cast<uint32_t>(i));
+    }
+    walls.flush();
+
+    // I nodi dell'indice tutti dentro il frustum non testano i loro alberi, quelli fuori li scartano in blocco
+    visible_ids.clear();
+    index.query(frustum, visible_ids);
+    culled = tree_spheres.size() - visible_ids.size();
+
+    // Alberi entrati nel frustum: quelli modulo per modulo riprendono le loro istanze,
+    // quelli cotti escono dal gruppo degli scartati quando si sceglie il loro livello
+    const uint32_t frame = ++visibility_frame;
+    next_visible_slots.clear();
+    for (const uint32_t id : visible_ids) {
+        const uint32_t slot = tree_slot[id];
+        seen_frame[slot] = frame;
+        next_visible_slots.push_back(slot);
+        if (tree_visible[slot] == 0) {
+            tree_visible[slot] = 1;
+            showModuleTree(slot, true);
+        }
+    }
+    // Alberi usciti: visibili prima e non visti in questo frame
+    for (const uint32_t slot : visible_slots) {
+        if (seen_frame[slot] != frame) {
+            tree_visible[slot] = 0;
+            if (slot < lod_trees.size()) {
+                moveLodTree(slot, CULLED_SLOT);
+            }
+            else {
+                showModuleTree(slot, false);
+            }
+        }
+    }
+    std::swap(visible_slots, next_visible_slots);
+
+    // Alberi cotti visibili: ognuno si sposta nel gruppo del suo livello solo se cambia,
+    // e le istanze riscritte sono solo quelle scambiate
+    for (const uint32_t i : visible_slots) {
+        if (i >= lod_trees.size()) {
+            continue;
+        }
+        LodTree &tree = lod_trees[i];
+        const glm::vec3 center(tree_spheres.x[i], tree_spheres.y[i], tree_spheres.z[i]);
+        const float distance = std::max(glm::length(center - eye), 1e-3f);
+        const float pixels = 2.0f * tree_spheres.r[i] / distance * pixels_per_unit;
+        // Si passa a un livello più fine solo oltre la soglia più il margine, a uno più grossolano
+        // solo sotto la soglia meno il margine
+        uint8_t level = tree.level;
+        while (level > 0 && pixels > LOD_PIXELS[level - 1] * (1.0f + LOD_HYSTERESIS)) {
+            level--;
+        }
+        while (static_cast<size_t>(level) + 1 < LOD_LEVELS && pixels < LOD_PIXELS[level] * (1.0f - LOD_HYSTERESIS)) {
+            level++;
+        }
+        tree.level = level;
+        moveLodTree(i, level);
+    }
+
+    // Comandi delle sole varianti i cui gruppi sono cambiati
+    for (const uint32_t v : changed_variants) {
+        LodVariant &variant = variants[v];
+        variant.changed = false;
+        for (size_t l = 0; l < BAKED_LEVELS; l++) {
+            const uint32_t count = variant.start[l + 1] - variant.start[l];
+            bark.set_instances(variant.bark_commands[l], count, variant.base + variant.start[l]);
+            leaves.set_instances(variant.leaf_commands[l], count, variant.base + variant.start[l]);
+        }
+        impostors.set_instances(v, variant.start[BAKED_LEVELS + 1] - variant.start[BAKED_LEVELS],
+                                variant.base + variant.start[BAKED_LEVELS]);
+    }
+    changed_variants.clear();
+
+    if (lod_dirty_first < lod_dirty_last) {
+        arena.update_instances(lod_base + lod_dirty_first, lod_instances.data() + lod_dirty_first, lod_dirty_last - lod_dirty_first);
+        lod_dirty_first = UINT32_MAX;
+        lod_dirty_last = 0;
+    }
+    bark.flush();
+    leaves.flush();
+    impostors.flush();
+}
+
+void SceneRenderer::showModuleTree(uint32_t slot, bool visible) {
+    if (slot < lod_trees.size()) {
+        return;
+    }
+    const ModuleTree &tree = module_trees[slot - lod_trees.size()];
+    for (size_t k = 0; k < MODULE_KINDS; k++) {
+        IndirectPass &pass = static_cast<TurtleOpKind>(k) == TurtleOpKind::Leaf ? leaves : bark;
+        pass.set_instances(tree.commands[k], visible ? tree.count[k] : 0, tree.base[k]);
+    }
+}
+
+void SceneRenderer::moveLodTree(size_t t, uint8_t slot) {
+    LodTree &tree = lod_trees[t];
+    if (tree.slot == slot) {
+        return;
+    }
+    LodVariant &variant = variants[tree.variant];
+    const uint32_t offset = variant.base - lod_base;
+    if (tree.slot < LOD_LEVELS) {
+        level_counts[tree.slot]--;
+    }
+    if (slot < LOD_LEVELS) {
+        level_counts[slot]++;
+    }
+    // Verso i gruppi successivi: in fondo al proprio gruppo, poi il confine si sposta indietro di uno
+    while (tree.slot < slot) {
+        swapLodInstances(tree.position, offset + variant.start[tree.slot + 1] - 1);
+        variant.start[tree.slot + 1]--;
+        tree.slot++;
+    }
+    // Verso i gruppi precedenti: in testa al proprio gruppo, poi il confine avanza di uno
+    while (tree.slot > slot) {
+        swapLodInstances(tree.position, offset + variant.start[tree.slot]);
+        variant.start[tree.slot]++;
+        tree.slot--;
+    }
+    if (!variant.changed) {
+        variant.changed = true;
+        changed_variants.push_back(tree.variant);
+    }
+}
+
+void SceneRenderer::swapLodInstances(uint32_t a, uint32_t b) {
+    if (a == b) {
+        return;
+    }
+    std::swap(lod_instances[a], lod_instances[b]);
+    std::swap(lod_at[a], lod_at[b]);
+    lod_trees[lod_at[a]].position = a;
+    lod_trees[lod_at[b]].position = b;
+    lod_dirty_first = std::min({lod_dirty_first, a, b});
+    lod_dirty_last = std::max({lod_dirty_last, a + 1, b + 1});
+}
+
+std::optional<size_t> SceneRenderer::pickTree(const glm::vec3 &origin, const glm::vec3 &direction) const {
+    if (const std::optional<SpatialIndex::Hit> hit = index.raycast(origin, direction)) {
+        return hit->id;
+    }
+    return std::nullopt;
+}
+
+void SceneRenderer::resolveUniforms(const Shader &impostors) {
+    impostor_views = impostors.uniform<int>("views");
+    impostor_layer_count = impostors.uniform<int>("layers");
+}
+
+void SceneRenderer::renderTerrain() const {
+    if (!terrain_visible) {
+        return;
+    }
+    terrain.draw(arena, terrain_material);
+}
+
+void SceneRenderer::renderTrees() const {
+    bark.draw(arena, bark_material);
+    leaves.draw(arena, leaf_material);
+}
+
+void SceneRenderer::renderImpostors() const {
+    if (impostor_layers == 0) {
+        return;
+    }
+    Shader::set(impostor_views, IMPOSTOR_VIEWS);
+    Shader::set(impostor_layer_count, impostor_layers);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, impostorBounds);
+    impostors.draw(arena, impostor_material);
+}
+
+void SceneRenderer::renderWalls() const {
+    walls.draw(arena, wall_material);
+}
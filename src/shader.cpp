@@ -3,8 +3,51 @@
 //
 
 #include "shader.h"
+#include "gl_state.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
 #include <vector>
 
+namespace {
+    // Oltre questa profondità un include è quasi certamente ricorsivo
+    constexpr int MAX_INCLUDE_DEPTH = 16;
+}
+
+std::string Shader::resolveIncludes(const std::string &source, const std::string &path, int depth) {
+    if (depth > MAX_INCLUDE_DEPTH) {
+        throw std::runtime_error("Errore: include annidati troppo in profondità in " + path);
+    }
+    std::istringstream in(source);
+    std::string out;
+    out.reserve(source.size());
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+            // #include "file": il percorso è relativo al file che include
+            const size_t open = line.find('"', start + 8);
+            const size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                throw std::runtime_error("Errore: include malformato in " + path + ": " + line);
+            }
+            const std::filesystem::path included = std::filesystem::path(path).parent_path() / line.substr(open + 1, close - open - 1);
+            std::ifstream file(included);
+            if (!file) {
+                throw std::runtime_error("Errore: impossibile aprire " + included.string() + " incluso da " + path);
+            }
+            std::stringstream stream;
+            stream << file.rdbuf();
+            out += resolveIncludes(stream.str(), included.string(), depth + 1);
+            out += '\n';
+            continue;
+        }
+        out += line;
+        out += '\n';
+    }
+    return out;
+}
+
 Shader::Shader(const char *vertexPath, const char *fragmentPath) {
     std::string v_code;
     std::string f_code;
@@ -32,6 +75,10 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath) {
         printf("Impossible to open %s or %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertexPath, fragmentPath);
     }
 
+    // Blocchi condivisi tra i programmi, come FrameData
+    v_code = resolveIncludes(v_code, vertexPath);
+    f_code = resolveIncludes(f_code, fragmentPath);
+
     // Create the shaders
     GLuint v_shader = glCreateShader(GL_VERTEX_SHADER);
     GLuint f_shader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -94,36 +141,100 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath) {
 
     glDeleteShader(v_shader);
     glDeleteShader(f_shader);
+
+    reflectUniforms();
+}
+
+void Shader::reflectUniforms() {
+    uniforms.clear();
+    GLint count = 0;
+    GLint max_length = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    std::vector<char> buffer(static_cast<size_t>(std::max(max_length, 1)));
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), max_length, &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), static_cast<size_t>(length));
+        const GLint location = glGetUniformLocation(ID, name.c_str());
+        // Gli uniform dentro un blocco non hanno location
+        if (location < 0) {
+            continue;
+        }
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            name.resize(name.size() - 3);
+            for (GLint element = 0; element < size; element++) {
+                const std::string element_name = name + "[" + std::to_string(element) + "]";
+                uniforms.emplace(element_name, glGetUniformLocation(ID, element_name.c_str()));
+            }
+        }
+        uniforms.emplace(std::move(name), location);
+    }
+}
+
+GLint Shader::location(std::string_view name) const {
+    const auto it = uniforms.find(name);
+    return it == uniforms.end() ? -1 : it->second;
+}
+
+void Shader::set(UniformHandle<bool> handle, bool value) {
+    glUniform1i(handle.location, static_cast<int>(value));
+}
+
+void Shader::set(UniformHandle<int> handle, int value) {
+    glUniform1i(handle.location, value);
+}
+
+void Shader::set(UniformHandle<float> handle, float value) {
+    glUniform1f(handle.location, value);
+}
+
+void Shader::set(UniformHandle<glm::vec3> handle, const glm::vec3 &value) {
+    glUniform3fv(handle.location, 1, &value[0]);
+}
+
+void Shader::set(UniformHandle<glm::vec4> handle, const glm::vec4 &value) {
+    glUniform4fv(handle.location, 1, &value[0]);
+}
+
+void Shader::set(UniformHandle<glm::mat4> handle, const glm::mat4 &value) {
+    glUniformMatrix4fv(handle.location, 1, GL_FALSE, &value[0][0]);
 }
 
 void Shader::use() {
-    glUseProgram(ID);
+    GLState::useProgram(ID);
 }
 
 void Shader::unuse() {
-    glDeleteProgram(ID);
+    GLState::deleteProgram(ID);
 }
 
 
-void Shader::setBool(const std::string& name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+void Shader::setBool(std::string_view name, bool value) const {
+    glUniform1i(location(name), (int)value);
 }
 
-void Shader::setInt(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setInt(std::string_view name, int value) const {
+    glUniform1i(location(name), value);
 }
 
-void Shader::setFloat(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setFloat(std::string_view name, float value) const {
+    glUniform1f(location(name), value);
+}
+void Shader::setVec3(std::string_view name, const glm::vec3 &value) const
+{
+    glUniform3fv(location(name), 1, &value[0]);
 }
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
+void Shader::setVec4(std::string_view name, const glm::vec4 &value) const
 {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform4fv(location(name), 1, &value[0]);
 }
-void Shader::setVec3(const std::string &str,const float x, const float y, const float z) const {
-    glUniform3f(glGetUniformLocation(ID, str.c_str()), x, y, z);
+void Shader::setVec3(std::string_view name, const float x, const float y, const float z) const {
+    glUniform3f(location(name), x, y, z);
 }
 
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+void Shader::setMat4(std::string_view name, const glm::mat4 &mat) const {
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
 }
\ No newline at end of file
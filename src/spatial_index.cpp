@@ -0,0 +1,341 @@
+//
+// Created by Niccolo on 29/06/2025.
+//
+
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+void SpatialIndex::reset(const Bounds &world, unsigned int depth) {
+    world_bounds = world;
+    levels = std::min(depth, MAX_DEPTH) + 1;
+    if (world.empty()) {
+        origin = glm::vec2(0.0f);
+        side = 1.0f;
+    }
+    else {
+        origin = glm::vec2(world.min.x, world.min.z);
+        side = std::max({world.max.x - world.min.x, world.max.z - world.min.z, 1e-3f});
+    }
+
+    level_start.resize(levels + 1);
+    level_start[0] = 0;
+    for (unsigned int d = 0; d < levels; d++) {
+        level_start[d + 1] = level_start[d] + (1u << d) * (1u << d);
+    }
+    nodes.clear();
+    nodes.resize(level_start[levels]);
+    slots.clear();
+    count = 0;
+}
+
+SpatialIndex::Cell SpatialIndex::locate(uint32_t node) const {
+    unsigned int level = 0;
+    while (level + 1 < levels && node >= level_start[level + 1]) {
+        level++;
+    }
+    const uint32_t offset = node - level_start[level];
+    const uint32_t width = 1u << level;
+    return {level, offset % width, offset / width};
+}
+
+SpatialIndex::Cell SpatialIndex::cell_for(const glm::vec3 &center, float radius) const {
+    // Livello più profondo in cui mezza cella di margine copre il raggio: side / 2^d >= 2 r
+    unsigned int level = levels - 1;
+    if (radius > 0.0f) {
+        const float fit = std::floor(std::log2(side / (2.0f * radius)));
+        level = static_cast<unsigned int>(std::clamp(fit, 0.0f, static_cast<float>(levels - 1)));
+    }
+    const uint32_t width = 1u << level;
+    const float cell = side / static_cast<float>(width);
+    const auto coordinate = [&](float v, float start) {
+        const float c = std::floor((v - start) / cell);
+        return static_cast<uint32_t>(std::clamp(c, 0.0f, static_cast<float>(width - 1)));
+    };
+    return {level, coordinate(center.x, origin.x), coordinate(center.z, origin.y)};
+}
+
+template<typename F>
+void SpatialIndex::climb(Cell cell, F &&f) {
+    for (;;) {
+        f(nodes[node_index(cell)]);
+        if (cell.level == 0) {
+            return;
+        }
+        cell = {cell.level - 1, cell.x / 2, cell.z / 2};
+    }
+}
+
+void SpatialIndex::update(uint32_t id, const glm::vec3 &center, float radius) {
+    if (levels == 0) {
+        reset(world_bounds);
+    }
+    if (id >= slots.size()) {
+        slots.resize(id + 1);
+    }
+    Bounds box;
+    box.expand(center, radius);
+
+    const Cell cell = cell_for(center, radius);
+    const uint32_t target = node_index(cell);
+    Slot &slot = slots[id];
+    if (slot.node == target) {
+        // Stessa cella: si aggiorna la sfera sul posto e si allargano le scatole
+        SphereSet &spheres = nodes[target].spheres;
+        spheres.x[slot.index] = center.x;
+        spheres.y[slot.index] = center.y;
+        spheres.z[slot.index] = center.z;
+        spheres.r[slot.index] = radius;
+        climb(cell, [&](Node &node) {
+            node.bounds.expand(box);
+        });
+        return;
+    }
+    if (slot.node != NONE) {
+        detach(id);
+    }
+
+    Node &node = nodes[target];
+    slot = {target, static_cast<uint32_t>(node.ids.size())};
+    node.ids.push_back(id);
+    node.spheres.push(center, radius);
+    climb(cell, [&](Node &n) {
+        n.subtree++;
+        n.bounds.expand(box);
+    });
+    count++;
+}
+
+void SpatialIndex::detach(uint32_t id) {
+    Slot &slot = slots[id];
+    Node &node = nodes[slot.node];
+    // Rimozione per scambio con l'ultima sfera del nodo
+    const uint32_t last = static_cast<uint32_t>(node.ids.size()) - 1;
+    if (slot.index != last) {
+        const uint32_t moved = node.ids[last];
+        node.ids[slot.index] = moved;
+        node.spheres.x[slot.index] = node.spheres.x[last];
+        node.spheres.y[slot.index] = node.spheres.y[last];
+        node.spheres.z[slot.index] = node.spheres.z[last];
+        node.spheres.r[slot.index] = node.spheres.r[last];
+        slots[moved].index = slot.index;
+    }
+    node.ids.pop_back();
+    node.spheres.x.pop_back();
+    node.spheres.y.pop_back();
+    node.spheres.z.pop_back();
+    node.spheres.r.pop_back();
+
+    climb(locate(slot.node), [](Node &n) {
+        n.subtree--;
+    });
+    slot = {};
+    count--;
+}
+
+void SpatialIndex::remove(uint32_t id) {
+    if (id < slots.size() && slots[id].node != NONE) {
+        detach(id);
+    }
+}
+
+void SpatialIndex::truncate(uint32_t n) {
+    for (uint32_t id = n; id < slots.size(); id++) {
+        remove(id);
+    }
+    if (slots.size() > n) {
+        slots.resize(n);
+    }
+}
+
+void SpatialIndex::refit() {
+    // Dalle foglie alla radice: ogni nodo è l'unione delle sue sfere e dei figli
+    for (uint32_t i = static_cast<uint32_t>(nodes.size()); i-- > 0;) {
+        Node &node = nodes[i];
+        node.bounds = {};
+        if (node.subtree == 0) {
+            continue;
+        }
+        for (size_t k = 0; k < node.ids.size(); k++) {
+            node.bounds.expand(glm::vec3(node.spheres.x[k], node.spheres.y[k], node.spheres.z[k]), node.spheres.r[k]);
+        }
+        const Cell cell = locate(i);
+        if (cell.level + 1 < levels) {
+            for (uint32_t dz = 0; dz < 2; dz++) {
+                for (uint32_t dx = 0; dx < 2; dx++) {
+                    node.bounds.expand(nodes[node_index({cell.level + 1, 2 * cell.x + dx, 2 * cell.z + dz})].bounds);
+                }
+            }
+        }
+    }
+}
+
+void SpatialIndex::collect(uint32_t index, std::vector<uint32_t> &out) const {
+    const Node &node = nodes[index];
+    if (node.subtree == 0) {
+        return;
+    }
+    out.insert(out.end(), node.ids.begin(), node.ids.end());
+    const Cell cell = locate(index);
+    if (cell.level + 1 < levels) {
+        for (uint32_t dz = 0; dz < 2; dz++) {
+            for (uint32_t dx = 0; dx < 2; dx++) {
+                collect(node_index({cell.level + 1, 2 * cell.x + dx, 2 * cell.z + dz}), out);
+            }
+        }
+    }
+}
+
+void SpatialIndex::query(const Frustum &frustum, std::vector<uint32_t> &out) const {
+    if (nodes.empty()) {
+        return;
+    }
+    query(0, frustum, out, cull_scratch);
+}
+
+void SpatialIndex::query(uint32_t index, const Frustum &frustum, std::vector<uint32_t> &out,
+                         std::vector<uint8_t> &scratch) const {
+    const Node &node = nodes[index];
+    if (node.subtree == 0) {
+        return;
+    }
+    switch (frustum.classify(node.bounds)) {
+        case Containment::Outside:
+            return;
+        case Containment::Inside:
+            // Tutto il sottoalbero è visibile senza altri test
+            collect(index, out);
+            return;
+        case Containment::Intersects:
+            break;
+    }
+    frustum.cull(node.spheres, scratch);
+    for (size_t k = 0; k < node.ids.size(); k++) {
+        if (scratch[k] != 0) {
+            out.push_back(node.ids[k]);
+        }
+    }
+    const Cell cell = locate(index);
+    if (cell.level + 1 < levels) {
+        for (uint32_t dz = 0; dz < 2; dz++) {
+            for (uint32_t dx = 0; dx < 2; dx++) {
+                query(node_index({cell.level + 1, 2 * cell.x + dx, 2 * cell.z + dz}), frustum, out, scratch);
+            }
+        }
+    }
+}
+
+void SpatialIndex::query(const glm::vec3 &center, float radius, std::vector<uint32_t> &out) const {
+    if (nodes.empty()) {
+        return;
+    }
+    query(0, center, radius, out);
+}
+
+void SpatialIndex::query(uint32_t index, const glm::vec3 &center, float radius, std::vector<uint32_t> &out) const {
+    const Node &node = nodes[index];
+    if (node.subtree == 0) {
+        return;
+    }
+    // Distanza tra il centro e il punto più vicino della scatola
+    const glm::vec3 nearest = glm::clamp(center, node.bounds.min, node.bounds.max);
+    const glm::vec3 gap = nearest - center;
+    if (glm::dot(gap, gap) > radius * radius) {
+        return;
+    }
+    for (size_t k = 0; k < node.ids.size(); k++) {
+        const glm::vec3 d = glm::vec3(node.spheres.x[k], node.spheres.y[k], node.spheres.z[k]) - center;
+        const float reach = radius + node.spheres.r[k];
+        if (glm::dot(d, d) <= reach * reach) {
+            out.push_back(node.ids[k]);
+        }
+    }
+    const Cell cell = locate(index);
+    if (cell.level + 1 < levels) {
+        for (uint32_t dz = 0; dz < 2; dz++) {
+            for (uint32_t dx = 0; dx < 2; dx++) {
+                query(node_index({cell.level + 1, 2 * cell.x + dx, 2 * cell.z + dz}), center, radius, out);
+            }
+        }
+    }
+}
+
+namespace {
+    // Distanza d'ingresso del raggio nella scatola (test delle lastre), negativa se la manca
+    float enter(const Bounds &box, const glm::vec3 &origin, const glm::vec3 &inverse, float max_distance) {
+        const glm::vec3 t0 = (box.min - origin) * inverse;
+        const glm::vec3 t1 = (box.max - origin) * inverse;
+        const glm::vec3 near = glm::min(t0, t1);
+        const glm::vec3 far = glm::max(t0, t1);
+        const float t_near = std::max({near.x, near.y, near.z, 0.0f});
+        const float t_far = std::min({far.x, far.y, far.z, max_distance});
+        return t_near <= t_far ? t_near : -1.0f;
+    }
+}
+
+std::optional<SpatialIndex::Hit> SpatialIndex::raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                                                       float max_distance) const {
+    std::optional<Hit> best;
+    if (nodes.empty()) {
+        return best;
+    }
+    // Con una componente nulla l'inverso è infinito e il test delle lastre resta corretto
+    const glm::vec3 inverse = 1.0f / direction;
+    raycast(0, origin, inverse, direction, best, max_distance);
+    return best;
+}
+
+void SpatialIndex::raycast(uint32_t index, const glm::vec3 &origin, const glm::vec3 &inverse, const glm::vec3 &direction,
+                           std::optional<Hit> &best, float max_distance) const {
+    const Node &node = nodes[index];
+    if (node.subtree == 0) {
+        return;
+    }
+    const float limit = best ? best->distance : max_distance;
+    if (node.bounds.empty() || enter(node.bounds, origin, inverse, limit) < 0.0f) {
+        return;
+    }
+    for (size_t k = 0; k < node.ids.size(); k++) {
+        const glm::vec3 oc = origin - glm::vec3(node.spheres.x[k], node.spheres.y[k], node.spheres.z[k]);
+        const float b = glm::dot(oc, direction);
+        const float c = glm::dot(oc, oc) - node.spheres.r[k] * node.spheres.r[k];
+        const float discriminant = b * b - c;
+        if (discriminant < 0.0f) {
+            continue;
+        }
+        // Prima intersezione davanti all'origine; se l'origine è dentro la sfera, la distanza è 0
+        const float t = std::max(-b - std::sqrt(discriminant), 0.0f);
+        if (-b + std::sqrt(discriminant) >= 0.0f && t <= (best ? best->distance : max_distance)) {
+            best = Hit{node.ids[k], t};
+        }
+    }
+
+    // Figli in ordine di ingresso, così i più lontani vengono spesso scartati
+    const Cell cell = locate(index);
+    if (cell.level + 1 >= levels) {
+        return;
+    }
+    std::array<std::pair<float, uint32_t>, 4> children{};
+    size_t n = 0;
+    for (uint32_t dz = 0; dz < 2; dz++) {
+        for (uint32_t dx = 0; dx < 2; dx++) {
+            const uint32_t child = node_index({cell.level + 1, 2 * cell.x + dx, 2 * cell.z + dz});
+            if (nodes[child].subtree == 0 || nodes[child].bounds.empty()) {
+                continue;
+            }
+            const float t = enter(nodes[child].bounds, origin, inverse, best ? best->distance : max_distance);
+            if (t >= 0.0f) {
+                children[n++] = {t, child};
+            }
+        }
+    }
+    std::sort(children.begin(), children.begin() + static_cast<std::ptrdiff_t>(n));
+    for (size_t k = 0; k < n; k++) {
+        if (best && children[k].first > best->distance) {
+            break;
+        }
+        raycast(children[k].second, origin, inverse, direction, best, max_distance);
+    }
+}
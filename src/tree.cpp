@@ -6,28 +6,27 @@
 
 #include <utility>
 
-Tree::Tree(const std::vector<glm::mat4> &transf, const std::vector<char> &mods, std::shared_ptr<Mesh> branch,
-    std::shared_ptr<Mesh> leaf, std::shared_ptr<Mesh> junc) : transforms(transf), model(mods), branch_ptr(branch), leaf_ptr(leaf), junc_ptr(junc) {
+Tree::Tree(TreeModules modules, std::shared_ptr<Mesh> branch, std::shared_ptr<Mesh> leaf, std::shared_ptr<Mesh> junc)
+    : modules(std::move(modules)), branch_ptr(std::move(branch)), leaf_ptr(std::move(leaf)), junc_ptr(std::move(junc)) {
+    // Le foglie hanno scala al più 1: basta allargare lo scheletro della distanza massima
+    // tra un vertice della foglia e il suo attacco
+    float leaf_extent = 0.0f;
+    if (leaf_ptr) {
+        const Bounds leaf_bounds = leaf_ptr->getBounds();
+        if (!leaf_bounds.empty()) {
+            leaf_extent = glm::length(glm::max(glm::abs(leaf_bounds.min), glm::abs(leaf_bounds.max)));
+        }
+    }
+    bounds = this->modules.bounds.inflated(leaf_extent);
 }
 
-void Tree::render(Shader &shader, const glm::mat4 &m_matrix) {
-    for (int i = 0; i < model.size(); i++) {
-        shader.setMat4("model", m_matrix * transforms[i]);
-        switch (auto c = model[i]) {
-            case 'F': {
-                branch_ptr->render(shader);
-                break;
-            }
-            case 'L': {
-                leaf_ptr->render(shader);
-                break;
-            }
-            case 'J': {
-                junc_ptr->render(shader);
-            }
-            default: {
-                break;
-            }
-        }
+const std::shared_ptr<Mesh> &Tree::getMesh(TurtleOpKind kind) const {
+    switch (kind) {
+        case TurtleOpKind::Leaf:
+            return leaf_ptr;
+        case TurtleOpKind::Junction:
+            return junc_ptr;
+        default:
+            return branch_ptr;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,379 @@
+//
+// Created by Niccolo on 26/06/2025.
+//
+
+#include "tree_baker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+    constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    uint64_t fnv1a(uint64_t hash, const void *data, size_t bytes) {
+        const auto *p = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < bytes; i++) {
+            hash ^= p[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    // Passi di quantizzazione: vertici più vicini di così vengono saldati
+    constexpr float POSITION_STEP = 1e-5f;
+    constexpr float NORMAL_STEP = 1e-3f;
+    constexpr float UV_STEP = 1e-4f;
+
+    struct WeldKey {
+        std::array<int32_t, 8> q;
+
+        bool operator==(const WeldKey &other) const {
+            return q == other.q;
+        }
+    };
+
+    struct WeldHash {
+        size_t operator()(const WeldKey &key) const {
+            return fnv1a(FNV_OFFSET, key.q.data(), sizeof(key.q));
+        }
+    };
+
+    int32_t quantize(float v, float step) {
+        return static_cast<int32_t>(std::lround(v / step));
+    }
+
+    WeldKey weld_key(const Vertex &v) {
+        return {{
+            quantize(v.position.x, POSITION_STEP), quantize(v.position.y, POSITION_STEP), quantize(v.position.z, POSITION_STEP),
+            quantize(v.normal.x, NORMAL_STEP), quantize(v.normal.y, NORMAL_STEP), quantize(v.normal.z, NORMAL_STEP),
+            quantize(v.texCoords.x, UV_STEP), quantize(v.texCoords.y, UV_STEP)
+        }};
+    }
+
+    using WeldTable = std::unordered_map<WeldKey, unsigned int, WeldHash>;
+
+    // Trasforma la geometria di un tipo di modulo per ogni istanza e la aggiunge a out saldando i vertici
+    void bake_modules(const BakedGeometry &part, const std::vector<ModuleInstance> &instances, BakedGeometry &out,
+                      WeldTable &table) {
+        constexpr unsigned int UNMAPPED = std::numeric_limits<unsigned int>::max();
+        std::vector<Vertex> transformed(part.vertices.size());
+        std::vector<unsigned int> remap;
+        out.indices.reserve(out.indices.size() + instances.size() * part.indices.size());
+
+        for (const ModuleInstance &m : instances) {
+            if (m.scale.x == 0.0f || m.scale.y == 0.0f || m.scale.z == 0.0f) {
+                continue;
+            }
+            // Stessa trasformazione del vertex shader: scala, rotazione, traslazione.
+            // Le normali si scalano con l'inversa prima di ruotarle
+            const glm::vec3 inverse_scale = 1.0f / m.scale;
+            for (size_t i = 0; i < part.vertices.size(); i++) {
+                const Vertex &v = part.vertices[i];
+                transformed[i] = {
+                    m.position + m.orientation * (m.scale * v.position),
+                    glm::normalize(m.orientation * (v.normal * inverse_scale)),
+                    v.texCoords
+                };
+            }
+            remap.assign(part.vertices.size(), UNMAPPED);
+            const auto weld = [&](unsigned int i) {
+                if (remap[i] == UNMAPPED) {
+                    const auto [it, added] = table.try_emplace(weld_key(transformed[i]), static_cast<unsigned int>(out.vertices.size()));
+                    if (added) {
+                        out.vertices.push_back(transformed[i]);
+                    }
+                    remap[i] = it->second;
+                }
+                return remap[i];
+            };
+
+            for (size_t t = 0; t < part.indices.size(); t += 3) {
+                const unsigned int a = weld(part.indices[t]);
+                const unsigned int b = weld(part.indices[t + 1]);
+                const unsigned int c = weld(part.indices[t + 2]);
+                // Dopo la saldatura i triangoli ai poli delle giunzioni collassano: si scartano
+                if (a == b || b == c || a == c) {
+                    continue;
+                }
+                const glm::vec3 cross = glm::cross(out.vertices[b].position - out.vertices[a].position,
+                                                   out.vertices[c].position - out.vertices[a].position);
+                if (glm::dot(cross, cross) <= std::numeric_limits<float>::min()) {
+                    continue;
+                }
+                out.indices.push_back(a);
+                out.indices.push_back(b);
+                out.indices.push_back(c);
+            }
+        }
+    }
+
+    // Tiene i triangoli con indici validi; con drop_caps scarta le basi del ramo, cioè i triangoli
+    // con tutte le normali lungo l'asse del modulo
+    BakedGeometry clean(const Mesh &mesh, bool drop_caps) {
+        BakedGeometry part;
+        part.vertices = mesh.vertices;
+        const auto n = static_cast<unsigned int>(mesh.vertices.size());
+        const auto is_cap = [&](unsigned int i) {
+            return std::abs(mesh.vertices[i].normal.y) > 0.999f;
+        };
+        const size_t count = mesh.indices.empty() ? n : mesh.indices.size();
+        for (size_t t = 0; t + 2 < count; t += 3) {
+            unsigned int corner[3];
+            for (size_t j = 0; j < 3; j++) {
+                corner[j] = mesh.indices.empty() ? static_cast<unsigned int>(t + j) : mesh.indices[t + j];
+            }
+            if (corner[0] >= n || corner[1] >= n || corner[2] >= n) {
+                continue;
+            }
+            if (drop_caps && is_cap(corner[0]) && is_cap(corner[1]) && is_cap(corner[2])) {
+                continue;
+            }
+            part.indices.insert(part.indices.end(), corner, corner + 3);
+        }
+        return part;
+    }
+
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        float bounds[6];
+        uint64_t vertices[BAKED_LEVELS][BAKED_MATERIALS];
+        uint64_t indices[BAKED_LEVELS][BAKED_MATERIALS];
+    };
+    constexpr char CACHE_MAGIC[4] = {'T', 'B', 'A', 'K'};
+}
+
+size_t BakedTree::bytes() const {
+    size_t total = 0;
+    for (const auto &level : levels) {
+        for (const BakedGeometry &group : level) {
+            total += group.vertices.size() * sizeof(Vertex) + group.indices.size() * sizeof(unsigned int);
+        }
+    }
+    return total;
+}
+
+TreeBaker::TreeBaker(const Mesh &branch, const Mesh &leaf, const Mesh &junction, const BranchSweeper &sweeper, bool swept,
+                     std::string cache_dir)
+    : sweeper(sweeper),
+      reduced(sweeper.length(), sweeper.radius(), sweeper.resolution() / REDUCED_RESOLUTION_DIVISOR),
+      swept(swept),
+      cache_dir(std::move(cache_dir)) {
+    parts[static_cast<size_t>(TurtleOpKind::Branch)] = clean(branch, true);
+    parts[static_cast<size_t>(TurtleOpKind::Leaf)] = clean(leaf, false);
+    parts[static_cast<size_t>(TurtleOpKind::Junction)] = clean(junction, false);
+    for (const Vertex &v : leaf.vertices) {
+        leaf_extent = std::max(leaf_extent, glm::length(v.position));
+    }
+
+    parts_hash = fnv1a(FNV_OFFSET, &FORMAT_VERSION, sizeof(FORMAT_VERSION));
+    for (const BakedGeometry &part : parts) {
+        parts_hash = fnv1a(parts_hash, part.vertices.data(), part.vertices.size() * sizeof(Vertex));
+        parts_hash = fnv1a(parts_hash, part.indices.data(), part.indices.size() * sizeof(unsigned int));
+    }
+    const float length = sweeper.length();
+    const float radius = sweeper.radius();
+    const unsigned int resolution = sweeper.resolution();
+    parts_hash = fnv1a(parts_hash, &length, sizeof(length));
+    parts_hash = fnv1a(parts_hash, &radius, sizeof(radius));
+    parts_hash = fnv1a(parts_hash, &resolution, sizeof(resolution));
+    parts_hash = fnv1a(parts_hash, &swept, sizeof(swept));
+}
+
+uint64_t TreeBaker::key(const TreeModules &modules) const {
+    uint64_t hash = parts_hash;
+    for (const std::vector<ModuleInstance> &kind : modules.kinds) {
+        const uint64_t size = kind.size();
+        hash = fnv1a(hash, &size, sizeof(size));
+        hash = fnv1a(hash, kind.data(), kind.size() * sizeof(ModuleInstance));
+    }
+    return hash;
+}
+
+size_t TreeBaker::estimate(const TreeModules &modules) const {
+    const auto part_bytes = [&](TurtleOpKind kind) {
+        const BakedGeometry &part = parts[static_cast<size_t>(kind)];
+        return modules.of(kind).size() * (part.vertices.size() * sizeof(Vertex) + part.indices.size() * sizeof(unsigned int));
+    };
+    const size_t branches = modules.of(TurtleOpKind::Branch).size();
+    const size_t bark = swept ? sweeper.estimate(branches) : part_bytes(TurtleOpKind::Branch) + part_bytes(TurtleOpKind::Junction);
+    // Il livello ridotto ha al massimo tante foglie quanto quello completo
+    return bark + reduced.estimate(branches) + 2 * part_bytes(TurtleOpKind::Leaf);
+}
+
+std::vector<ModuleInstance> TreeBaker::merge_leaves(const std::vector<ModuleInstance> &leaves) const {
+    struct Cluster {
+        glm::vec3 sum;
+        uint32_t count;
+        ModuleInstance first;
+    };
+    const float cell = std::max(2.0f * leaf_extent, 1e-6f);
+    std::unordered_map<uint64_t, size_t> cluster_of;
+    std::vector<Cluster> clusters;
+    for (const ModuleInstance &m : leaves) {
+        const int64_t q[3] = {
+            static_cast<int64_t>(std::floor(m.position.x / cell)),
+            static_cast<int64_t>(std::floor(m.position.y / cell)),
+            static_cast<int64_t>(std::floor(m.position.z / cell))
+        };
+        const auto [it, added] = cluster_of.try_emplace(fnv1a(FNV_OFFSET, q, sizeof(q)), clusters.size());
+        if (added) {
+            clusters.push_back({m.position, 1, m});
+        }
+        else {
+            clusters[it->second].sum += m.position;
+            clusters[it->second].count++;
+        }
+    }
+
+    // Una foglia per cella, nel baricentro, con l'orientamento della prima foglia e l'area
+    // complessiva del gruppo (entro MAX_CARD_GROWTH)
+    std::vector<ModuleInstance> merged;
+    merged.reserve(clusters.size());
+    for (const Cluster &c : clusters) {
+        const float growth = std::min(std::sqrt(static_cast<float>(c.count)), MAX_CARD_GROWTH);
+        merged.push_back({c.sum / static_cast<float>(c.count), c.first.orientation, c.first.scale * growth});
+    }
+    return merged;
+}
+
+std::shared_ptr<const BakedTree> TreeBaker::bake(const TreeModules &modules, uint64_t key) const {
+    if (!cache_dir.empty()) {
+        if (std::shared_ptr<BakedTree> cached = load(key)) {
+            return cached;
+        }
+    }
+
+    auto tree = std::make_shared<BakedTree>();
+    tree->key = key;
+    constexpr auto BARK = static_cast<size_t>(BakedMaterial::Bark);
+    constexpr auto LEAF = static_cast<size_t>(BakedMaterial::Leaf);
+    const BakedGeometry &leaf_part = parts[static_cast<size_t>(TurtleOpKind::Leaf)];
+
+    // Livello completo: una tabella di saldatura per materiale, rami e giunzioni possono condividere i vertici
+    auto &full = tree->levels[0];
+    WeldTable table;
+    if (swept) {
+        // I tubi sostituiscono sia i rami sia le giunzioni
+        sweeper.sweep(modules.of(TurtleOpKind::Branch), full[BARK].vertices, full[BARK].indices);
+    }
+    else {
+        bake_modules(parts[static_cast<size_t>(TurtleOpKind::Branch)], modules.of(TurtleOpKind::Branch), full[BARK], table);
+        bake_modules(parts[static_cast<size_t>(TurtleOpKind::Junction)], modules.of(TurtleOpKind::Junction), full[BARK], table);
+    }
+    table.clear();
+    bake_modules(leaf_part, modules.of(TurtleOpKind::Leaf), full[LEAF], table);
+
+    // Livello ridotto: tubi con meno lati e una foglia per cella
+    auto &low = tree->levels[1];
+    reduced.sweep(modules.of(TurtleOpKind::Branch), low[BARK].vertices, low[BARK].indices);
+    table.clear();
+    bake_modules(leaf_part, merge_leaves(modules.of(TurtleOpKind::Leaf)), low[LEAF], table);
+
+    for (const BakedGeometry &group : full) {
+        for (const Vertex &v : group.vertices) {
+            tree->bounds.expand(v.position);
+        }
+    }
+
+    if (!cache_dir.empty()) {
+        store(*tree);
+    }
+    return tree;
+}
+
+std::string TreeBaker::cache_path(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tree", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(cache_dir) / name).string();
+}
+
+std::shared_ptr<BakedTree> TreeBaker::load(uint64_t key) const {
+    std::ifstream file(cache_path(key), std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+    CacheHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.version != FORMAT_VERSION || header.key != key) {
+        return nullptr;
+    }
+
+    auto tree = std::make_shared<BakedTree>();
+    tree->key = key;
+    tree->bounds.min = glm::vec3(header.bounds[0], header.bounds[1], header.bounds[2]);
+    tree->bounds.max = glm::vec3(header.bounds[3], header.bounds[4], header.bounds[5]);
+    for (size_t l = 0; l < BAKED_LEVELS; l++) {
+        for (size_t m = 0; m < BAKED_MATERIALS; m++) {
+            BakedGeometry &group = tree->levels[l][m];
+            group.vertices.resize(header.vertices[l][m]);
+            group.indices.resize(header.indices[l][m]);
+            file.read(reinterpret_cast<char *>(group.vertices.data()), static_cast<std::streamsize>(group.vertices.size() * sizeof(Vertex)));
+            file.read(reinterpret_cast<char *>(group.indices.data()), static_cast<std::streamsize>(group.indices.size() * sizeof(unsigned int)));
+            if (!file) {
+                return nullptr;
+            }
+            // Un file troncato o corrotto viene ignorato e l'albero ricotto
+            for (const unsigned int i : group.indices) {
+                if (i >= group.vertices.size()) {
+                    return nullptr;
+                }
+            }
+        }
+    }
+    return tree;
+}
+
+void TreeBaker::store(const BakedTree &tree) const {
+    // La cache è facoltativa: se non si riesce a scrivere l'albero resta solo in memoria
+    std::error_code error;
+    std::filesystem::create_directories(cache_dir, error);
+    if (error) {
+        return;
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = FORMAT_VERSION;
+    header.key = tree.key;
+    for (int i = 0; i < 3; i++) {
+        header.bounds[i] = tree.bounds.min[i];
+        header.bounds[3 + i] = tree.bounds.max[i];
+    }
+    for (size_t l = 0; l < BAKED_LEVELS; l++) {
+        for (size_t m = 0; m < BAKED_MATERIALS; m++) {
+            header.vertices[l][m] = tree.levels[l][m].vertices.size();
+            header.indices[l][m] = tree.levels[l][m].indices.size();
+        }
+    }
+
+    // Scrittura su un file temporaneo e rinomina, così una lettura non vede mai un file a metà
+    const std::string path = cache_path(tree.key);
+    const std::string partial = path + ".part";
+    {
+        std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const auto &level : tree.levels) {
+            for (const BakedGeometry &group : level) {
+                file.write(reinterpret_cast<const char *>(group.vertices.data()), static_cast<std::streamsize>(group.vertices.size() * sizeof(Vertex)));
+                file.write(reinterpret_cast<const char *>(group.indices.data()), static_cast<std::streamsize>(group.indices.size() * sizeof(unsigned int)));
+            }
+        }
+        if (!file) {
+            file.close();
+            std::filesystem::remove(partial, error);
+            return;
+        }
+    }
+    std::filesystem::rename(partial, path, error);
+}
@@ -4,12 +4,16 @@
 
 #include "utils.h"
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <unordered_map>
 #include "camera.h"
+#include "gl_state.h"
 #include "interpreter.h"
 #include "junction_builder.h"
 #include "lindenmayer.h"
+#include "tree_baker.h"
 
 
 
@@ -92,7 +96,7 @@ unsigned int loadTexture(char const *path) {
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLState::bindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -114,29 +118,29 @@ std::vector<Texture> chooseTextures(const Biomes biomes) {
     switch (biomes) {
         case Biomes::MOUNTAINS: // Mountains
             return {
-                {loadTexture("../textures/Snow/textures/snow_02_diff_1k.png"), "texture_diffuse"},
-                {loadTexture("../textures/Rock/rock_face_03_diff_1k.png"), "texture_diffuse"},
-                {loadTexture("../textures/Rock/aerial_rocks_02_diff_1k.png"), "texture_diffuse"},
-                {loadTexture("../textures/Rock/rocky_terrain_02_diff_1k.png"), "texture_diffuse"}
+                {loadTexture("../textures/Snow/textures/snow_02_diff_1k.png"), TextureKind::Diffuse},
+                {loadTexture("../textures/Rock/rock_face_03_diff_1k.png"), TextureKind::Diffuse},
+                {loadTexture("../textures/Rock/aerial_rocks_02_diff_1k.png"), TextureKind::Diffuse},
+                {loadTexture("../textures/Rock/rocky_terrain_02_diff_1k.png"), TextureKind::Diffuse}
             };
         case Biomes::HILLS: // Hills
             return {
-                {loadTexture("../textures/grass/leafy_grass_diff_1k.png"), "texture_diffuse"},
-                {loadTexture("../textures/grass/brown_mud_leaves_01_diff_1k.png"), "texture_diffuse"},
-                {loadTexture("../textures/Rock/rocky_terrain_02_diff_1k.png"), "texture_diffuse"},
-                {loadTexture("../textures/grass/aerial_grass_rock_diff_1k.png"), "texture_diffuse"}
+                {loadTexture("../textures/grass/leafy_grass_diff_1k.png"), TextureKind::Diffuse},
+                {loadTexture("../textures/grass/brown_mud_leaves_01_diff_1k.png"), TextureKind::Diffuse},
+                {loadTexture("../textures/Rock/rocky_terrain_02_diff_1k.png"), TextureKind::Diffuse},
+                {loadTexture("../textures/grass/aerial_grass_rock_diff_1k.png"), TextureKind::Diffuse}
             };
         case Biomes::DESERT: // Desert
             return {
-                {loadTexture("../textures/Sand/rock_boulder_cracked_diff_1k.png"), "texture_diffuse"},
-                {loadTexture("../textures/Sand/sandy_gravel_02_diff_1k.png"), "texture_diffuse"},
+                {loadTexture("../textures/Sand/rock_boulder_cracked_diff_1k.png"), TextureKind::Diffuse},
+                {loadTexture("../textures/Sand/sandy_gravel_02_diff_1k.png"), TextureKind::Diffuse},
             };
         case Biomes::ISLANDS: // Islands
             return {
-                {loadTexture("../textures/Rock/rocky_terrain_02_diff_1k.png"), "texture_diffuse"},
-                {loadTexture("../textures/Sand/aerial_beach_01_diff_1k.png"), "texture_diffuse"},
-                {loadTexture("../textures/Waves/0012.png"), "texture_normal"},
-                {loadTexture("../textures/Waves/0071.png"), "texture_normal"},
+                {loadTexture("../textures/Rock/rocky_terrain_02_diff_1k.png"), TextureKind::Diffuse},
+                {loadTexture("../textures/Sand/aerial_beach_01_diff_1k.png"), TextureKind::Diffuse},
+                {loadTexture("../textures/Waves/0012.png"), TextureKind::Normal},
+                {loadTexture("../textures/Waves/0071.png"), TextureKind::Normal},
 
 
             };
@@ -150,7 +154,7 @@ unsigned int loadCubemap(const std::vector<std::string> &faces) {
 
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GLState::bindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
     for (unsigned int i = 0; i < faces.size(); i++) {
@@ -163,7 +167,7 @@ unsigned int loadCubemap(const std::vector<std::string> &faces) {
         } else {
             std::cerr << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
             stbi_image_free(data);
-            glDeleteTextures(1, &textureID);
+            GLState::deleteTextures(1, &textureID);
             return 0;
         }
     }
@@ -229,7 +233,7 @@ Mesh setSkyBox() {
     unsigned int cubemapTexture = loadCubemap(faces);
 
     std::vector<Texture> skyboxTextures = {
-        {cubemapTexture, "texture_cubemap"}
+        {cubemapTexture, TextureKind::Cubemap}
     };
 
     return {vertices, indices, skyboxTextures};
@@ -248,7 +252,7 @@ Mesh setWater() {
         0, 3, 2
     };
     std::vector<Texture> waterTextures = {
-        {loadTexture("../textures/Waves/0012.png"), "texture_normal"}
+        {loadTexture("../textures/Waves/0012.png"), TextureKind::Normal}
     };
 
     return {waterVertices, waterIndices, waterTextures};
@@ -310,11 +314,11 @@ Mesh setWall() {
 
 
     std::vector<Texture> textures = {
-        {loadTexture("../textures/Walls/wooden_garage_door_diff_1k.png"), "texture_diffuse"},
-        {loadTexture("../textures/Walls/wooden_garage_door_arm_1k.png"), "texture_specular"}
+        {loadTexture("../textures/Walls/wooden_garage_door_diff_1k.png"), TextureKind::Diffuse},
+        {loadTexture("../textures/Walls/wooden_garage_door_arm_1k.png"), TextureKind::Specular}
 
     };
-    // {loadTexture("../textures/Walls/wooden_garage_door_spec_1k.png"), "texture_specular"},
+    // {loadTexture("../textures/Walls/wooden_garage_door_spec_1k.png"), TextureKind::Specular},
     for (auto vertex: textures) {
     }
     return {vertices, indices, textures};
@@ -470,6 +474,22 @@ TreeConfig getConfig(Biomes biome) {
     }
 }
 
+std::vector<ArenaInstance> wallInstances() {
+    // Ogni muro è ruotato attorno a Y e poi spostato nel sistema ruotato: model = R * T
+    const glm::vec3 offsets[4] = {
+        glm::vec3(-0.5f, 0.0f, -0.5f),
+        glm::vec3(0.0f, 0.0f, -0.5f),
+        glm::vec3(-19.5f, 0.0f, -19.5f),
+        glm::vec3(19.0f, 0.0f, -19.5f)
+    };
+    std::vector<ArenaInstance> walls;
+    for (int i = 0; i < 4; i++) {
+        const glm::quat rotation = glm::angleAxis(glm::radians(90.0f * i), glm::vec3(0.0f, 1.0f, 0.0f));
+        walls.push_back({rotation * offsets[i], glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w), glm::vec3(1.0f)});
+    }
+    return walls;
+}
+
 Mesh setElevation(const Biomes biome, Shader shader) {
     NoiseGenerator gen;
     const BiomeSettings biomeSettings = gen.biomePresets[biome];
@@ -492,7 +512,44 @@ std::vector<Point> generateTreePositions(const Mesh terrain, Biomes biome, float
     return treePos;
 }
 
-auto makeForest(std::vector<std::string> trees, const TreeConfig& config) -> std::vector<Tree> {
+std::vector<glm::vec3> treeOrigins(const Mesh& terrain, const std::vector<Point>& positions) {
+    std::vector<glm::vec3> origins;
+    origins.reserve(positions.size());
+    for (const Point& p : positions) {
+        origins.emplace_back(p.x, terrain.getHeight(p.x, p.y), p.y);
+    }
+    return origins;
+}
+
+GrowthEstimate estimateForest(const Lindenmayer& lsystem, const TreeConfig& config, size_t nTrees) {
+    GrowthEstimate tree = lsystem.estimate(config.starting_production, std::max(config.production_iterations, 0));
+    const auto n = static_cast<double>(nTrees);
+    return {
+        tree.expected_length * n,
+        tree.worst_length * n,
+        tree.expected_branches * n,
+        tree.expected_leaves * n,
+        tree.expected_junctions * n,
+        tree.worst_modules * n
+    };
+}
+
+int clampIterations(const Lindenmayer& lsystem, const TreeConfig& config, size_t nTrees, const GenerationBudget& budget) {
+    const auto n = static_cast<double>(nTrees);
+    constexpr double bytes_per_module = sizeof(ModuleInstance);
+    int iterations = std::max(config.production_iterations, 0);
+    while (iterations > 0) {
+        const GrowthEstimate e = lsystem.estimate(config.starting_production, iterations);
+        if (e.expected_modules() * n * bytes_per_module <= budget.max_memory_mb * 1024.0 * 1024.0 &&
+            e.expected_length * n <= budget.max_symbols) {
+            break;
+        }
+        iterations--;
+    }
+    return iterations;
+}
+
+auto makeForest(const TreeConfig& config, Lindenmayer& lsystem, size_t nTrees, const GenerationBudget& budget) -> std::vector<Tree> {
 
     std::unique_ptr<Branch> sBranch = std::make_unique<Branch>(config.bark_texture_path, config.resolution);
     std::unique_ptr<Leaf> sLeaf = std::make_unique<Leaf>(config.leaf_texture_path, config.leaf_type);
@@ -505,31 +562,76 @@ auto makeForest(std::vector<std::string> trees, const TreeConfig& config) -> std
     std::shared_ptr<Mesh> leaf_ptr = sLeaf->getResult();
     std::shared_ptr<Mesh> junc_ptr = sJunc->getResult();
 
-    Interpreter turtle = Interpreter(config.angle, glm::vec3(0.0f), config.branch_radius, config.branch_length, config.radius_decay);
+    const Interpreter interpreter(config.angle, config.branch_radius, config.branch_length, config.radius_decay);
+    // Stack della turtle riutilizzato da tutti gli alberi
+    TurtleScratch scratch;
+    // Il sistema L arriva dal chiamante: stesso seed, stessa foresta, e i livelli già derivati restano in cache
+    lsystem.set_memoization(true);
+    lsystem.set_worker_pool(&WorkerPool::shared());
+    lsystem.set_cache_budget(static_cast<size_t>(budget.max_cache_mb * 1024.0 * 1024.0));
+
+    // Oltre il budget si generano meno iterazioni invece di bloccare l'applicazione
+    const int iterations = clampIterations(lsystem, config, nTrees, budget);
 
     std::vector<Tree> forest{};
+    forest.reserve(nTrees);
+
+    // L'interprete dimensiona i vettori per tipo con il conteggio esatto dei moduli
+    TreeModules modules;
+    for (size_t i = 0; i < nTrees; i++) {
+        modules.clear();
+
+        // La derivazione alimenta direttamente l'ottimizzatore, dal livello in cache o in profondità se
+        // non entra. 'X' diventa 'F' nello stesso passaggio, quindi niente pulizia della stringa
+        TurtleOptimizer optimizer(interpreter, scratch);
+        lsystem.derive(i, config.starting_production, iterations, [&](char c, unsigned int count) {
+            optimizer.feed(c, count);
+        });
+        // Gli alberi grandi vengono interpretati a sottoalberi sul pool
+        interpreter.run(optimizer.finish(), scratch, modules, glm::vec3(0.0f), &WorkerPool::shared());
+        forest.emplace_back(std::move(modules), branch_ptr, leaf_ptr, junc_ptr);
+    }
 
-    for (const auto& tree: trees) {
-        turtle.reset_interpreter(glm::vec3(0));
-        std::vector<char> models {};
-        std::vector<glm::mat4> transforms {};
+    // Gli alberi non si animano: finché c'è budget si cuociono in una mesh per materiale.
+    // Alberi identici hanno la stessa chiave e diventano istanze della stessa variante
+    const BranchSweeper sweeper(config.branch_length, config.branch_radius, config.resolution);
+    const TreeBaker baker(*branch_ptr, *leaf_ptr, *junc_ptr, sweeper, config.swept_branches);
+    const auto baked_budget = static_cast<size_t>(budget.max_baked_mb * 1024.0 * 1024.0);
+    size_t baked_bytes = 0;
+    std::unordered_map<uint64_t, size_t> variant_of;
+    std::vector<size_t> variant_tree;
+    std::vector<uint64_t> variant_key;
+    std::vector<size_t> tree_variant(forest.size(), SIZE_MAX);
+    for (size_t i = 0; i < forest.size(); i++) {
+        const uint64_t key = baker.key(forest[i].getModules());
+        if (const auto it = variant_of.find(key); it != variant_of.end()) {
+            tree_variant[i] = it->second;
+            continue;
+        }
+        const size_t bytes = baker.estimate(forest[i].getModules());
+        if (baked_bytes + bytes > baked_budget) {
+            continue;
+        }
+        baked_bytes += bytes;
+        tree_variant[i] = variant_tree.size();
+        variant_of.emplace(key, variant_tree.size());
+        variant_tree.push_back(i);
+        variant_key.push_back(key);
+    }
 
-        turtle.read_string(tree, models, transforms);
-        forest.emplace_back(transforms, models, branch_ptr, leaf_ptr, junc_ptr);
+    std::vector<std::shared_ptr<const BakedTree>> variants(variant_tree.size());
+    WorkerPool::shared().parallel_for(variants.size(), [&](size_t v) {
+        variants[v] = baker.bake(forest[variant_tree[v]].getModules(), variant_key[v]);
+    });
+    for (size_t i = 0; i < forest.size(); i++) {
+        if (tree_variant[i] != SIZE_MAX) {
+            forest[i].setBaked(variants[tree_variant[i]]);
+        }
     }
 
     return forest;
 }
 
-std::vector<std::string> treeStrings(const TreeConfig& config, int nTrees) {
-    std::vector<std::string> treeStrings{};
-    auto l = Lindenmayer(config.production_rules);
-    for (int i=0; i < nTrees; i++) {
-        treeStrings.push_back(l.generate(config.starting_production, config.production_iterations, true));
-    }
-    return treeStrings;
-}
-
 std::vector<Tree> adjustForest(const TreeConfig& config) {
     return {};
 }
@@ -0,0 +1,92 @@
+//
+// Created by Niccolo on 18/06/2025.
+//
+
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(unsigned int n_threads) {
+    for (unsigned int i = 1; i < n_threads; i++) {
+        workers.emplace_back(&WorkerPool::worker_loop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::parallel_for(size_t n, const std::function<void(size_t)> &task) {
+    if (n == 0) {
+        return;
+    }
+    if (workers.empty() || n == 1) {
+        for (size_t i = 0; i < n; i++) {
+            task(i);
+        }
+        return;
+    }
+    {
+        std::lock_guard lock(mutex);
+        current = &task;
+        n_tasks = n;
+        next_task = 0;
+        running = 0;
+        generation++;
+    }
+    wake.notify_all();
+    run_tasks();
+
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this] { return next_task >= n_tasks && running == 0; });
+    current = nullptr;
+}
+
+WorkerPool &WorkerPool::shared() {
+    static WorkerPool pool;
+    return pool;
+}
+
+void WorkerPool::worker_loop() {
+    unsigned long seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        run_tasks();
+    }
+}
+
+void WorkerPool::run_tasks() {
+    while (true) {
+        size_t i;
+        const std::function<void(size_t)> *task;
+        {
+            std::lock_guard lock(mutex);
+            if (current == nullptr || next_task >= n_tasks) {
+                return;
+            }
+            i = next_task++;
+            running++;
+            task = current;
+        }
+        (*task)(i);
+        {
+            std::lock_guard lock(mutex);
+            running--;
+            if (next_task >= n_tasks && running == 0) {
+                done.notify_all();
+            }
+        }
+    }
+}